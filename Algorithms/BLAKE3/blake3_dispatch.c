@@ -8,11 +8,36 @@
 #include <immintrin.h>
 #endif
 
+// The x64 flavor links every x86 implementation and picks one at runtime,
+// the others only link what they were compiled for.
+#if defined(OHT_RUNTIME_DISPATCH)
+#include <cpufeatures.h>
+
+static bool has_avx512(void) {
+  return cpu_has(CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512VL);
+}
+
+static bool has_avx2(void) { return cpu_has(CPU_FEATURE_AVX2); }
+
+static bool has_sse41(void) { return cpu_has(CPU_FEATURE_SSE41); }
+#endif
+
 void blake3_compress_in_place(uint32_t cv[8],
                               const uint8_t block[BLAKE3_BLOCK_LEN],
                               uint8_t block_len, uint64_t counter,
                               uint8_t flags) {
 
+#if defined(OHT_RUNTIME_DISPATCH)
+  if (has_avx512()) {
+    blake3_compress_in_place_avx512(cv, block, block_len, counter, flags);
+    return;
+  }
+  if (has_sse41()) {
+    blake3_compress_in_place_sse41(cv, block, block_len, counter, flags);
+    return;
+  }
+#endif
+
 #if defined(__AVX512VL__) && defined(__AVX512F__)
   blake3_compress_in_place_avx512(cv, block, block_len, counter, flags);
 #elif defined(__SSE4_1__)
@@ -29,6 +54,17 @@ void blake3_compress_xof(const uint32_t cv[8],
                          uint8_t block_len, uint64_t counter, uint8_t flags,
                          uint8_t out[64]) {
 
+#if defined(OHT_RUNTIME_DISPATCH)
+  if (has_avx512()) {
+    blake3_compress_xof_avx512(cv, block, block_len, counter, flags, out);
+    return;
+  }
+  if (has_sse41()) {
+    blake3_compress_xof_sse41(cv, block, block_len, counter, flags, out);
+    return;
+  }
+#endif
+
 #if defined(__AVX512VL__) && defined(__AVX512F__)
   blake3_compress_xof_avx512(cv, block, block_len, counter, flags, out);
 #elif defined(__SSE4_1__)
@@ -45,6 +81,27 @@ void blake3_hash_many(const uint8_t *const *inputs, size_t num_inputs,
                       bool increment_counter, uint8_t flags,
                       uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
 
+#if defined(OHT_RUNTIME_DISPATCH)
+  if (has_avx512()) {
+    blake3_hash_many_avx512(inputs, num_inputs, blocks, key, counter,
+      increment_counter, flags, flags_start, flags_end,
+      out);
+    return;
+  }
+  if (has_avx2()) {
+    blake3_hash_many_avx2(inputs, num_inputs, blocks, key, counter,
+      increment_counter, flags, flags_start, flags_end,
+      out);
+    return;
+  }
+  if (has_sse41()) {
+    blake3_hash_many_sse41(inputs, num_inputs, blocks, key, counter,
+      increment_counter, flags, flags_start, flags_end,
+      out);
+    return;
+  }
+#endif
+
 #if defined(__AVX512VL__) && defined(__AVX512F__)
   blake3_hash_many_avx512(inputs, num_inputs, blocks, key, counter,
     increment_counter, flags, flags_start, flags_end,
@@ -75,6 +132,13 @@ void blake3_hash_many(const uint8_t *const *inputs, size_t num_inputs,
 // The dynamically detected SIMD degree of the current platform.
 size_t blake3_simd_degree(void) {
 
+#if defined(OHT_RUNTIME_DISPATCH)
+  if (has_avx512())
+    return 16;
+  if (has_avx2())
+    return 8;
+#endif
+
 #if defined(__AVX512VL__) && defined(__AVX512F__)
   return 16;
 #elif defined(__AVX2__)
@@ -0,0 +1,148 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "blake3_subtree.h"
+
+#include "BLAKE3/c/blake3_impl.h"
+
+// Chunks hashed with a single blake3_hash_many call, enough to fill the widest
+// SIMD implementation twice
+#define SUBTREE_LEAF_CHUNKS 32
+
+// Largest complete subtree starting at chunk_counter that fits in chunks
+static uint64_t subtree_chunks(uint64_t chunk_counter, uint64_t chunks) {
+  uint64_t subtree = round_down_to_power_of_2(chunks);
+  while (chunk_counter & (subtree - 1))
+    subtree >>= 1;
+  return subtree;
+}
+
+static void parent_cv(const uint32_t key[8], uint8_t flags,
+                      const uint8_t block[BLAKE3_BLOCK_LEN],
+                      uint8_t out[BLAKE3_OUT_LEN]) {
+  uint32_t cv[8];
+  memcpy(cv, key, sizeof(cv));
+  blake3_compress_in_place(cv, block, BLAKE3_BLOCK_LEN, 0, flags | PARENT);
+  store_cv_words(out, cv);
+}
+
+// Chaining value of a complete subtree, which is never the root here. chunks
+// is a power of two
+static void subtree_cv(const uint32_t key[8], uint8_t flags,
+                       const uint8_t *input, uint64_t chunks,
+                       uint64_t chunk_counter, uint8_t out[BLAKE3_OUT_LEN]) {
+  if (chunks > SUBTREE_LEAF_CHUNKS) {
+    const uint64_t half = chunks / 2;
+    uint8_t children[2 * BLAKE3_OUT_LEN];
+    subtree_cv(key, flags, input, half, chunk_counter, children);
+    subtree_cv(key, flags, input + half * BLAKE3_CHUNK_LEN, half,
+               chunk_counter + half, children + BLAKE3_OUT_LEN);
+    parent_cv(key, flags, children, out);
+    return;
+  }
+
+  const uint8_t *inputs[SUBTREE_LEAF_CHUNKS];
+  uint8_t cvs[2][SUBTREE_LEAF_CHUNKS * BLAKE3_OUT_LEN];
+  size_t count = (size_t)chunks;
+  for (size_t i = 0; i < count; ++i)
+    inputs[i] = input + i * BLAKE3_CHUNK_LEN;
+  blake3_hash_many(inputs, count, BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN, key,
+                   chunk_counter, true, flags, CHUNK_START, CHUNK_END, cvs[0]);
+
+  // Pairs of chaining values are parent blocks, reduce them level by level
+  size_t level = 0;
+  for (; count > 1; count /= 2, level ^= 1) {
+    for (size_t i = 0; i < count / 2; ++i)
+      inputs[i] = cvs[level] + i * BLAKE3_BLOCK_LEN;
+    blake3_hash_many(inputs, count / 2, 1, key, 0, false, flags | PARENT, 0, 0,
+                     cvs[level ^ 1]);
+  }
+  memcpy(out, cvs[level], BLAKE3_OUT_LEN);
+}
+
+size_t blake3_subtree_count(uint64_t offset, size_t size) {
+  uint64_t chunk_counter = offset / BLAKE3_CHUNK_LEN;
+  uint64_t chunks = size / BLAKE3_CHUNK_LEN;
+  size_t count = 0;
+  while (chunks) {
+    const uint64_t subtree = subtree_chunks(chunk_counter, chunks);
+    chunk_counter += subtree;
+    chunks -= subtree;
+    ++count;
+  }
+  return count;
+}
+
+void blake3_subtree_cvs(const blake3_hasher *self, uint64_t offset,
+                        const uint8_t *input, size_t size, uint8_t *cvs) {
+  uint64_t chunk_counter = offset / BLAKE3_CHUNK_LEN;
+  uint64_t chunks = size / BLAKE3_CHUNK_LEN;
+  while (chunks) {
+    const uint64_t subtree = subtree_chunks(chunk_counter, chunks);
+    subtree_cv(self->key, self->chunk.flags, input, subtree, chunk_counter, cvs);
+    input += subtree * BLAKE3_CHUNK_LEN;
+    cvs += BLAKE3_OUT_LEN;
+    chunk_counter += subtree;
+    chunks -= subtree;
+  }
+}
+
+static void push_cv(blake3_hasher *self, const uint8_t cv[BLAKE3_OUT_LEN],
+                    uint64_t chunks) {
+  // Same as the hasher does before pushing: merge everything the new subtree
+  // completes, so the stack holds one value per set bit of the chunk count
+  const size_t post_merge_len = popcnt(self->chunk.chunk_counter);
+  while (self->cv_stack_len > post_merge_len) {
+    uint8_t *parent = &self->cv_stack[(self->cv_stack_len - 2) * BLAKE3_OUT_LEN];
+    parent_cv(self->key, self->chunk.flags, parent, parent);
+    self->cv_stack_len -= 1;
+  }
+
+  memcpy(&self->cv_stack[self->cv_stack_len * BLAKE3_OUT_LEN], cv,
+         BLAKE3_OUT_LEN);
+  self->cv_stack_len += 1;
+
+  self->chunk.chunk_counter += chunks;
+}
+
+void blake3_hasher_push_subtrees(blake3_hasher *self, size_t size,
+                                 const uint8_t *cvs) {
+  // The hasher keeps a complete chunk to itself until more input shows up, in
+  // case it's the root. More input is here, so finish it like the hasher would
+  if (self->chunk.blocks_compressed * BLAKE3_BLOCK_LEN + self->chunk.buf_len ==
+      BLAKE3_CHUNK_LEN) {
+    uint32_t cv_words[8];
+    uint8_t cv[BLAKE3_OUT_LEN];
+    memcpy(cv_words, self->chunk.cv, sizeof(cv_words));
+    blake3_compress_in_place(cv_words, self->chunk.buf, self->chunk.buf_len,
+                             self->chunk.chunk_counter,
+                             self->chunk.flags | CHUNK_END);
+    store_cv_words(cv, cv_words);
+    push_cv(self, cv, 1);
+
+    memcpy(self->chunk.cv, self->key, BLAKE3_KEY_LEN);
+    memset(self->chunk.buf, 0, BLAKE3_BLOCK_LEN);
+    self->chunk.buf_len = 0;
+    self->chunk.blocks_compressed = 0;
+  }
+
+  uint64_t chunks = size / BLAKE3_CHUNK_LEN;
+  while (chunks) {
+    const uint64_t subtree = subtree_chunks(self->chunk.chunk_counter, chunks);
+    push_cv(self, cvs, subtree);
+    cvs += BLAKE3_OUT_LEN;
+    chunks -= subtree;
+  }
+}
@@ -0,0 +1,59 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#ifndef EXTERN_C_START
+#ifdef __cplusplus
+#define EXTERN_C_START extern "C" {
+#define EXTERN_C_END }
+#else
+#define EXTERN_C_START
+#define EXTERN_C_END
+#endif
+#endif
+
+EXTERN_C_START
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <blake3.h>
+
+// Hashing a run of whole chunks apart from the hasher, possibly on another
+// thread, then folding it in when the hasher gets there. The run is split into
+// the same complete subtrees blake3_hasher_update would split it into, and
+// only their chaining values are kept.
+//
+// A run must not be the end of the message: the root node can only be
+// finalized by the hasher, so at least one more byte has to follow through
+// blake3_hasher_update.
+
+// Number of subtrees a run at offset splits into. Both offset and size must be
+// multiples of BLAKE3_CHUNK_LEN
+size_t blake3_subtree_count(uint64_t offset, size_t size);
+
+// Write the chaining values of the run's subtrees to cvs, BLAKE3_OUT_LEN bytes
+// each. Only reads the key and flags of the hasher.
+void blake3_subtree_cvs(const blake3_hasher *self, uint64_t offset,
+                        const uint8_t *input, size_t size, uint8_t *cvs);
+
+// Fold in chaining values of a run starting right where the hasher is, the
+// hasher must have taken whole chunks so far. These may have come through
+// blake3_hasher_update
+void blake3_hasher_push_subtrees(blake3_hasher *self, size_t size,
+                                 const uint8_t *cvs);
+
+EXTERN_C_END
@@ -15,6 +15,8 @@
 //    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
 #include "Hasher2.h"
 
+#include <algorithm>
+#include <iterator>
 #include <new>
 #include <numeric>
 #include <limits>
@@ -31,17 +33,29 @@
 #include "Hasher2.h"
 #include <Crc32.h>
 #include <blake3.h>
+#include <blake3_subtree.h>
 extern "C" {
 #include "KeccakHash.h"
 #include "KangarooTwelve.h"
 #include "SP800-185.h"
+#include <KeccakLeaves.h>
+#include <KeccakMany.h>
 }
 #include "crc64.h"
+#include <crcfold.h>
+#include <qxhfast.h>
+#include <streebogfast.h>
 #include <quickxorhash.h>
+#include <multibuffer.h>
+#include <shaext.h>
 
 #define XXH_STATIC_LINKING_ONLY
 
 #include <xxhash.h>
+#if defined(OHT_RUNTIME_DISPATCH)
+// Replaces the XXH3 update functions with ones that pick SSE2, AVX2 or AVX512
+#include <xxh_x86dispatch.h>
+#endif
 
 extern "C" {
 #define uint512_u uint512_u_STREEBOG
@@ -58,13 +72,95 @@ template <
   int (*StartsRet)(Ctx* ctx),
   void (*Free)(Ctx* ctx),
   int (*UpdateRet)(Ctx* ctx, const unsigned char*, size_t),
-  int (*FinishRet)(Ctx* ctx, unsigned char*)
+  int (*FinishRet)(Ctx* ctx, unsigned char*),
+  void (*ManyBlocks)(mb::Stream* streams, size_t count) = nullptr,
+  auto FastBlocks = nullptr,
+  size_t FastManyBelowLanes = 0
 >
 class MbedHashContext final : public HashContext
 {
   Ctx ctx{};
 
+  static constexpr size_t k_block_size = sizeof(ctx.buffer);
+
+  static_assert(ManyBlocks == nullptr || k_block_size == mb::k_block_size);
+
+  static void AddTotal(uint32_t (&total)[2], uint64_t bytes)
+  {
+    const auto sum = ((uint64_t)total[1] << 32 | total[0]) + bytes;
+    total[0] = (uint32_t)sum;
+    total[1] = (uint32_t)(sum >> 32);
+  }
+
+  // SHA-384 and SHA-512 count in 128 bits
+  static void AddTotal(uint64_t (&total)[2], uint64_t bytes)
+  {
+    total[0] += bytes;
+    total[1] += total[0] < bytes;
+  }
+
+  // Lets mbedtls fill up its buffer first, then accounts for the whole blocks
+  // after it as if they were hashed already. Returns the number of these,
+  // bytes and size are left pointing to the tail after them.
+  static size_t TakeBlocks(Ctx& ctx, const uint8_t*& bytes, size_t& size)
+  {
+    const auto buffered = ctx.total[0] % k_block_size;
+    if (buffered)
+    {
+      const auto fill = std::min(size, k_block_size - buffered);
+      UpdateRet(&ctx, bytes, fill);
+      bytes += fill;
+      size -= fill;
+    }
+
+    const auto blocks = size / k_block_size;
+    AddTotal(ctx.total, blocks * k_block_size);
+    size %= k_block_size;
+    return blocks;
+  }
+
 public:
+  static constexpr bool k_has_update_many = ManyBlocks != nullptr;
+
+  // Whole blocks are hashed straight into the mbedtls states by the kernel,
+  // mbedtls buffers whatever is before and after them like it would anyways
+  static void UpdateMany(MbedHashContext* const* ctxs, const void* const* data, const size_t* sizes, size_t count)
+  {
+    // Narrow multi-buffer kernels lose to streams hashed one by one on the SHA
+    // extensions, so these take over the batch if present
+    if constexpr (FastBlocks != nullptr)
+    {
+      if (mb::lanes() < FastManyBelowLanes && FastBlocks())
+      {
+        for (size_t i = 0; i < count; ++i)
+          ctxs[i]->Update(data[i], sizes[i]);
+        return;
+      }
+    }
+
+    constexpr size_t k_chunk = 64;
+    mb::Stream streams[k_chunk];
+    size_t tails[k_chunk];
+    for (size_t done = 0; done < count; done += k_chunk)
+    {
+      const auto n = std::min(count - done, k_chunk);
+      for (size_t i = 0; i < n; ++i)
+      {
+        auto& ctx = ctxs[done + i]->ctx;
+        auto bytes = (const uint8_t*)data[done + i];
+        auto size = sizes[done + i];
+        const auto blocks = TakeBlocks(ctx, bytes, size);
+        streams[i] = { ctx.state, bytes, blocks };
+        tails[i] = size;
+      }
+
+      ManyBlocks(streams, n);
+
+      for (size_t i = 0; i < n; ++i)
+        UpdateRet(&ctxs[done + i]->ctx, streams[i].data + streams[i].blocks * mb::k_block_size, tails[i]);
+    }
+  }
+
   MbedHashContext()
   {
     Init(&ctx);
@@ -73,6 +169,18 @@ public:
 
   void Update(const void* data, size_t size)
   {
+    if constexpr (FastBlocks != nullptr)
+    {
+      if (const auto fast_blocks = FastBlocks())
+      {
+        auto bytes = (const uint8_t*)data;
+        const auto blocks = TakeBlocks(ctx, bytes, size);
+        fast_blocks(ctx.state, bytes, blocks);
+        UpdateRet(&ctx, bytes + blocks * k_block_size, size);
+        return;
+      }
+    }
+
     UpdateRet(&ctx, (const unsigned char*)data, size);
   }
 
@@ -97,6 +205,17 @@ public:
   &mbedtls_ ## name ## _finish_ret\
 >
 
+#define MBED_MB_HASH_CONTEXT_TYPE(name, size) MbedHashContext<\
+  mbedtls_ ## name ## _context,\
+  (size),\
+  &mbedtls_ ## name ## _init,\
+  &mbedtls_ ## name ## _starts_ret,\
+  &mbedtls_ ## name ## _free,\
+  &mbedtls_ ## name ## _update_ret,\
+  &mbedtls_ ## name ## _finish_ret,\
+  &mb::name ## _many\
+>
+
 template <bool is224>
 int sha256_starts_ret_binder(mbedtls_sha256_context* ctx) { return mbedtls_sha256_starts_ret(ctx, is224); }
 
@@ -105,9 +224,20 @@ int sha512_starts_ret_binder(mbedtls_sha512_context* ctx) { return mbedtls_sha51
 
 using Md2HashContext = MBED_HASH_CONTEXT_TYPE(md2, 16);
 using Md4HashContext = MBED_HASH_CONTEXT_TYPE(md4, 16);
-using Md5HashContext = MBED_HASH_CONTEXT_TYPE(md5, 16);
-using RipeMD160HashContext = MBED_HASH_CONTEXT_TYPE(ripemd160, 20);
-using Sha1HashContext = MBED_HASH_CONTEXT_TYPE(sha1, 20);
+using Md5HashContext = MBED_MB_HASH_CONTEXT_TYPE(md5, 16);
+using RipeMD160HashContext = MBED_MB_HASH_CONTEXT_TYPE(ripemd160, 20);
+using Sha1HashContext = MbedHashContext<
+  mbedtls_sha1_context,
+  20,
+  &mbedtls_sha1_init,
+  &mbedtls_sha1_starts_ret,
+  &mbedtls_sha1_free,
+  &mbedtls_sha1_update_ret,
+  &mbedtls_sha1_finish_ret,
+  &mb::sha1_many,
+  &shaext::sha1_blocks,
+  8
+>;
 using Sha224HashContext = MbedHashContext<
   mbedtls_sha256_context,
   28,
@@ -115,7 +245,10 @@ using Sha224HashContext = MbedHashContext<
   &sha256_starts_ret_binder<true>,
   &mbedtls_sha256_free,
   &mbedtls_sha256_update_ret,
-  &mbedtls_sha256_finish_ret
+  &mbedtls_sha256_finish_ret,
+  &mb::sha256_many,
+  &shaext::sha256_blocks,
+  16
 >;
 using Sha256HashContext = MbedHashContext<
   mbedtls_sha256_context,
@@ -124,7 +257,10 @@ using Sha256HashContext = MbedHashContext<
   &sha256_starts_ret_binder<false>,
   &mbedtls_sha256_free,
   &mbedtls_sha256_update_ret,
-  &mbedtls_sha256_finish_ret
+  &mbedtls_sha256_finish_ret,
+  &mb::sha256_many,
+  &shaext::sha256_blocks,
+  16
 >;
 using Sha384HashContext = MbedHashContext<
   mbedtls_sha512_context,
@@ -133,7 +269,9 @@ using Sha384HashContext = MbedHashContext<
   &sha512_starts_ret_binder<true>,
   &mbedtls_sha512_free,
   &mbedtls_sha512_update_ret,
-  &mbedtls_sha512_finish_ret
+  &mbedtls_sha512_finish_ret,
+  nullptr,
+  &shaext::sha512_blocks
 >;
 using Sha512HashContext = MbedHashContext<
   mbedtls_sha512_context,
@@ -142,7 +280,9 @@ using Sha512HashContext = MbedHashContext<
   &sha512_starts_ret_binder<false>,
   &mbedtls_sha512_free,
   &mbedtls_sha512_update_ret,
-  &mbedtls_sha512_finish_ret
+  &mbedtls_sha512_finish_ret,
+  nullptr,
+  &shaext::sha512_blocks
 >;
 
 class Blake2SpHashContext final : public HashContext
@@ -173,14 +313,41 @@ public:
 
 class Crc32HashContext final : public HashContext
 {
+  crcfold::Crc32Fn* clmul = crcfold::crc32_clmul();
   uint32_t crc{};
 
 public:
   Crc32HashContext() {}
 
+  uint32_t Crc(uint32_t crc, const void* data, size_t size)
+  {
+    return clmul ? clmul(crc, data, size) : crc32_fast(data, size, crc);
+  }
+
   void Update(const void* data, size_t size)
   {
-    crc = crc32_fast(data, size, crc);
+    crc = Crc(crc, data, size);
+  }
+
+  // Any run can be a piece, summarized as its own CRC
+  static constexpr bool k_has_pieces = true;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    return size ? sizeof(uint32_t) : 0;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    const auto piece = Crc(0, data, size);
+    memcpy(summary, &piece, sizeof(piece));
+  }
+
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    uint32_t piece;
+    memcpy(&piece, summary, sizeof(piece));
+    crc = crcfold::crc32_combine(crc, piece, size);
   }
 
   void Finish(uint8_t* out)
@@ -199,14 +366,41 @@ public:
 
 class Crc64HashContext final : public HashContext
 {
+  crcfold::Crc64Fn* clmul = crcfold::crc64_clmul();
   uint64_t crc{};
 
 public:
   Crc64HashContext() {}
 
+  uint64_t Crc(uint64_t crc, const void* data, size_t size)
+  {
+    return clmul ? clmul(crc, data, size) : crc64(crc, data, size);
+  }
+
   void Update(const void* data, size_t size)
   {
-    crc = crc64(crc, data, size);
+    crc = Crc(crc, data, size);
+  }
+
+  // Any run can be a piece, summarized as its own CRC
+  static constexpr bool k_has_pieces = true;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    return size ? sizeof(uint64_t) : 0;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    const auto piece = Crc(0, data, size);
+    memcpy(summary, &piece, sizeof(piece));
+  }
+
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    uint64_t piece;
+    memcpy(&piece, summary, sizeof(piece));
+    crc = crcfold::crc64_combine(crc, piece, size);
   }
 
   void Finish(uint8_t* out)
@@ -227,9 +421,11 @@ public:
   }
 };
 
-template <bool ExtraNullVersion>
-class ED2kHashContext final : public HashContext
+// The chunking is the same for both eD2k variants, they only disagree on how
+// a message of whole chunks ends
+class ED2kChunks : public HashContext
 {
+protected:
   mbedtls_md4_context current_chunk{};
   mbedtls_md4_context root_hash{};
   uint8_t last_chunk_hash[16] = { 0x31, 0xd6, 0xcf, 0xe0, 0xd1, 0x6a, 0xe9, 0x31, 0xb7, 0x3c, 0x59, 0xd7, 0xe0, 0xc0, 0x89, 0xc0 };
@@ -258,7 +454,7 @@ class ED2kHashContext final : public HashContext
   }
 
 public:
-  ED2kHashContext()
+  ED2kChunks()
   {
     mbedtls_md4_init(&current_chunk);
     mbedtls_md4_starts_ret(&current_chunk);
@@ -269,16 +465,55 @@ public:
 
   void Update(const void* data, size_t size)
   {
-    const auto bytes = (const uint8_t*)data;
-    const auto needed_for_next_chunk = (size_t)(((hashed / k_chunk_size) + 1) * k_chunk_size - hashed);
-    const auto first_part = std::min(needed_for_next_chunk, size);
-    const auto second_part = size - first_part;
+    auto bytes = (const uint8_t*)data;
+    while (size)
+    {
+      const auto needed_for_next_chunk = (size_t)(k_chunk_size - hashed % k_chunk_size);
+      const auto part = std::min(needed_for_next_chunk, size);
+      UpdateInternal(bytes, part);
+      bytes += part;
+      size -= part;
+    }
+  }
+
+  // Pieces are whole chunks, summarized as their MD4. The message never ends
+  // on a piece, so how the two variants finish doesn't change
+  static constexpr bool k_has_pieces = true;
+  static constexpr size_t k_piece_size = k_chunk_size;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    return offset % k_chunk_size == 0 && size == k_chunk_size ? sizeof(last_chunk_hash) : 0;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    mbedtls_md4_ret((const uint8_t*)data, size, summary);
+  }
 
-    UpdateInternal(bytes, first_part);
-    if (second_part)
-      UpdateInternal(bytes + first_part, second_part);
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    memcpy(last_chunk_hash, summary, sizeof(last_chunk_hash));
+    mbedtls_md4_update_ret(&root_hash, last_chunk_hash, sizeof(last_chunk_hash));
+    hashed += size;
+  }
+
+  static constexpr const char* k_absorb_family = "eD2k";
+
+  void AbsorbFrom(const HashContext* other)
+  {
+    const auto& chunks = *(const ED2kChunks*)other;
+    mbedtls_md4_clone(&current_chunk, &chunks.current_chunk);
+    mbedtls_md4_clone(&root_hash, &chunks.root_hash);
+    memcpy(last_chunk_hash, chunks.last_chunk_hash, sizeof(last_chunk_hash));
+    hashed = chunks.hashed;
   }
+};
 
+template <bool ExtraNullVersion>
+class ED2kHashContext final : public ED2kChunks
+{
+public:
   void Finish(uint8_t* out)
   {
     if (hashed < k_chunk_size)
@@ -349,6 +584,35 @@ public:
     blake3_hasher_update(&ctx, data, size);
   }
 
+  // Pieces are runs of whole chunks, summarized as the chaining values of
+  // their subtrees
+  static constexpr bool k_has_pieces = true;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    if (!size || offset % BLAKE3_CHUNK_LEN || size % BLAKE3_CHUNK_LEN)
+      return 0;
+    return blake3_subtree_count(offset, size) * BLAKE3_OUT_LEN;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    blake3_subtree_cvs(&ctx, offset, (const uint8_t*)data, size, summary);
+  }
+
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    blake3_hasher_push_subtrees(&ctx, size, summary);
+  }
+
+  // Any output length can be read from the same hasher
+  static constexpr const char* k_absorb_family = "BLAKE3";
+
+  void AbsorbFrom(const HashContext* other)
+  {
+    ctx = ((const Blake3HashContext*)other)->ctx;
+  }
+
   void Finish(uint8_t* out)
   {
     blake3_hasher_finalize(&ctx, out, out_len);
@@ -544,6 +808,46 @@ public:
     Keccak_HashUpdate(&ctx, (const BitSequence*)data, size * 8);
   }
 
+  static constexpr bool k_has_update_many = true;
+
+  // Whole blocks go through the parallel permutations, the sponges take
+  // whatever is before and after them like they would anyways. The rates may
+  // differ, so variants of the same message can be hashed side by side too
+  static void UpdateMany(KeccakHashContext* const* ctxs, const void* const* data, const size_t* sizes, size_t count)
+  {
+    constexpr size_t k_chunk = 64;
+    KeccakWidth1600_Stream streams[k_chunk];
+    const uint8_t* tails[k_chunk];
+    size_t tail_sizes[k_chunk];
+    for (size_t done = 0; done < count; done += k_chunk)
+    {
+      const auto n = std::min(count - done, k_chunk);
+      for (size_t i = 0; i < n; ++i)
+      {
+        auto& sponge = ctxs[done + i]->ctx.sponge;
+        const size_t rate = sponge.rate / 8;
+        auto bytes = (const uint8_t*)data[done + i];
+        auto size = sizes[done + i];
+        if (sponge.byteIOIndex)
+        {
+          const auto fill = std::min(size, rate - sponge.byteIOIndex);
+          ctxs[done + i]->Update(bytes, fill);
+          bytes += fill;
+          size -= fill;
+        }
+        const auto blocks = sponge.byteIOIndex ? 0 : size / rate;
+        streams[i] = { &sponge, bytes, blocks };
+        tails[i] = bytes + blocks * rate;
+        tail_sizes[i] = size - blocks * rate;
+      }
+
+      KeccakWidth1600_SpongeAbsorbMany(streams, n);
+
+      for (size_t i = 0; i < n; ++i)
+        ctxs[done + i]->Update(tails[i], tail_sizes[i]);
+    }
+  }
+
   void Finish(uint8_t* out)
   {
     Keccak_HashFinal(&ctx, (BitSequence*)out);
@@ -582,6 +886,38 @@ public:
     KangarooTwelve_Update(&ctx, (const unsigned char*)data, size);
   }
 
+  // Pieces are runs of whole leaves past the first one, summarized as their
+  // chaining values
+  static constexpr bool k_has_pieces = true;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    if (!size || offset < KangarooTwelve_leafLen || offset % KangarooTwelve_leafLen || size % KangarooTwelve_leafLen)
+      return 0;
+    return size / KangarooTwelve_leafLen * KangarooTwelve_leafCVLen;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    KangarooTwelve_HashLeaves((const unsigned char*)data, size / KangarooTwelve_leafLen, summary);
+  }
+
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    KangarooTwelve_AbsorbLeaves(&ctx, summary, size / KangarooTwelve_leafLen);
+  }
+
+  // The output length is only used by the final node, and there's never a
+  // customization string
+  static constexpr const char* k_absorb_family = "K12";
+
+  void AbsorbFrom(const HashContext* other)
+  {
+    const auto output_length = ctx.fixedOutputLength;
+    ctx = ((const KangarooTwelveHashContext*)other)->ctx;
+    ctx.fixedOutputLength = output_length;
+  }
+
   void Finish(uint8_t* out)
   {
     KangarooTwelve_Final(&ctx, out, (const unsigned char*)"", 0);
@@ -597,6 +933,8 @@ class ParallelHash128HashContext final : public HashContext
 {
   ParallelHash_Instance ctx{};
 
+  size_t block_len{};
+
 public:
   constexpr static const char* k_params[] = {
     "Block length",
@@ -613,6 +951,7 @@ public:
   }
 
   ParallelHash128HashContext(const uint64_t* params)
+    : block_len((size_t)params[0])
   {
     ParallelHash128_Initialize(&ctx, (size_t)params[0], (size_t)params[1], nullptr, 0);
   }
@@ -622,6 +961,26 @@ public:
     ParallelHash128_Update(&ctx, (const unsigned char*)data, size);
   }
 
+  // Pieces are runs of whole blocks, summarized as their chaining values
+  static constexpr bool k_has_pieces = true;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    if (!size || !block_len || offset % block_len || size % block_len)
+      return 0;
+    return size / block_len * ParallelHash128_leafCVLen;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    ParallelHash128_HashLeaves((const unsigned char*)data, block_len, size / block_len, summary);
+  }
+
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    ParallelHash128_AbsorbLeaves(&ctx, summary, size / block_len);
+  }
+
   void Finish(uint8_t* out)
   {
     ParallelHash128_Final(&ctx, out);
@@ -637,6 +996,8 @@ class ParallelHash256HashContext final : public HashContext
 {
   ParallelHash_Instance ctx{};
 
+  size_t block_len{};
+
 public:
   constexpr static const char* k_params[] = {
     "Block length",
@@ -653,6 +1014,7 @@ public:
   }
 
   ParallelHash256HashContext(const uint64_t* params)
+    : block_len((size_t)params[0])
   {
     ParallelHash256_Initialize(&ctx, (size_t)params[0], (size_t)params[1], nullptr, 0);
   }
@@ -662,6 +1024,26 @@ public:
     ParallelHash256_Update(&ctx, (const unsigned char*)data, size);
   }
 
+  // Pieces are runs of whole blocks, summarized as their chaining values
+  static constexpr bool k_has_pieces = true;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    if (!size || !block_len || offset % block_len || size % block_len)
+      return 0;
+    return size / block_len * ParallelHash256_leafCVLen;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    ParallelHash256_HashLeaves((const unsigned char*)data, block_len, size / block_len, summary);
+  }
+
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    ParallelHash256_AbsorbLeaves(&ctx, summary, size / block_len);
+  }
+
   void Finish(uint8_t* out)
   {
     ParallelHash256_Final(&ctx, out);
@@ -676,22 +1058,32 @@ public:
 template <unsigned Bits>
 class GOST34112012HashContext final : public HashContext
 {
+  // The reference context is only used when there is no fast kernel
+  streebogfast::CompressFn* fast = streebogfast::compress_fast();
+  streebogfast::State state{};
   GOST34112012Context ctx{};
 
 public:
   GOST34112012HashContext()
   {
+    streebogfast::init(&state, Bits);
     GOST34112012Init(&ctx, Bits);
   }
 
   void Update(const void* data, size_t size)
   {
-    GOST34112012Update(&ctx, (const unsigned char*)data, size);
+    if (fast)
+      streebogfast::update(&state, fast, data, size);
+    else
+      GOST34112012Update(&ctx, (const unsigned char*)data, size);
   }
 
   void Finish(uint8_t* out)
   {
-    GOST34112012Final(&ctx, out);
+    if (fast)
+      streebogfast::final(&state, fast, out);
+    else
+      GOST34112012Final(&ctx, out);
   }
 
   size_t GetOutputSize()
@@ -705,22 +1097,110 @@ using GOST34112012_512HashContext = GOST34112012HashContext<512>;
 
 class QuickXorHashContext final : public HashContext
 {
+  // Byte n of the message is XORed in at bit n * 11 of a 160 bit rotation,
+  // and the length into the last 8 bytes
+  constexpr static unsigned k_width = QUICKXORHASH_SIZE * 8;
+  constexpr static unsigned k_shift = 11;
+
+  // The reference state is only used when there is no vector kernel
+  qxhfast::UpdateFn* simd = qxhfast::update_simd();
+  qxhfast::State fast{};
   qxhash ctx{};
 
+  // Pieces are XORed in here instead of ctx, which only gets enough zeros to
+  // keep its shift in step. Both are merged at the end, with the length fixed.
+  uint8_t pieces[QUICKXORHASH_SIZE]{};
+  uint64_t length{};
+  uint64_t ctx_length{};
+
+  static void XorLength(uint8_t* hash, uint64_t length)
+  {
+    for (size_t i = 0; i < 8; ++i)
+      hash[QUICKXORHASH_SIZE - 8 + i] ^= (uint8_t)(length >> (i * 8));
+  }
+
+  // Hash of data from position 0, with the length
+  void HashOnce(const void* data, size_t size, uint8_t* out)
+  {
+    if (simd)
+    {
+      qxhfast::State state;
+      qxhfast::init(&state);
+      simd(&state, data, size);
+      qxhfast::final(&state, out);
+    }
+    else
+    {
+      qxhash state{};
+      qxhash_init(&state);
+      qxhash_update(&state, (const uint8_t*)data, size);
+      qxhash_final(&state, out);
+    }
+  }
+
+  void UpdateCtx(const void* data, size_t size)
+  {
+    if (simd)
+      simd(&fast, data, size);
+    else
+      qxhash_update(&ctx, (const uint8_t*)data, size);
+    ctx_length += size;
+  }
+
 public:
   QuickXorHashContext()
   {
+    qxhfast::init(&fast);
     qxhash_init(&ctx);
   }
 
   void Update(const void* data, size_t size)
   {
-    qxhash_update(&ctx, (const uint8_t*)data, size);
+    UpdateCtx(data, size);
+    length += size;
+  }
+
+  // Any run can be a piece, summarized as its hash from position 0 without
+  // the length
+  static constexpr bool k_has_pieces = true;
+
+  size_t PieceSummarySize(uint64_t offset, size_t size)
+  {
+    return size ? QUICKXORHASH_SIZE : 0;
+  }
+
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    HashOnce(data, size, summary);
+    XorLength(summary, size);
+  }
+
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    const auto rotate = (unsigned)(offset % k_width * k_shift % k_width);
+    const auto bytes = rotate / 8;
+    const auto bits = rotate % 8;
+    for (size_t i = 0; i < QUICKXORHASH_SIZE; ++i)
+    {
+      pieces[(i + bytes) % QUICKXORHASH_SIZE] ^= (uint8_t)(summary[i] << bits);
+      if (bits)
+        pieces[(i + bytes + 1) % QUICKXORHASH_SIZE] ^= (uint8_t)(summary[i] >> (8 - bits));
+    }
+    length = offset + size;
+
+    constexpr static uint8_t zeros[k_width]{};
+    UpdateCtx(zeros, (size_t)((length - ctx_length) % k_width));
   }
 
   void Finish(uint8_t* out)
   {
-    qxhash_final(&ctx, out);
+    if (simd)
+      qxhfast::final(&fast, out);
+    else
+      qxhash_final(&ctx, out);
+    XorLength(out, ctx_length ^ length);
+    for (size_t i = 0; i < QUICKXORHASH_SIZE; ++i)
+      out[i] ^= pieces[i];
   }
 
   size_t GetOutputSize()
@@ -729,6 +1209,87 @@ public:
   }
 };
 
+template <typename T, class = void>
+class UpdateManyTraits
+{
+public:
+  static constexpr auto update_many_fn = nullptr;
+};
+
+template <typename T>
+class UpdateManyTraits<T, std::enable_if_t<T::k_has_update_many>>
+{
+  static void ALGORITHMS_CC UpdateMany(HashContext* const* ctxs, const void* const* data, const size_t* sizes, size_t count)
+  {
+    T::UpdateMany((T* const*)ctxs, data, sizes, count);
+  }
+
+public:
+  static constexpr auto update_many_fn = &UpdateMany;
+};
+
+template <typename T, class = void>
+constexpr size_t k_piece_size_of = 0;
+
+template <typename T>
+constexpr size_t k_piece_size_of<T, std::void_t<decltype(T::k_piece_size)>> = T::k_piece_size;
+
+template <typename T, class = void>
+class PieceTraits
+{
+public:
+  static constexpr auto piece_summary_size_fn = nullptr;
+  static constexpr auto hash_piece_fn = nullptr;
+  static constexpr auto absorb_piece_fn = nullptr;
+  static constexpr size_t piece_size = 0;
+};
+
+template <typename T>
+class PieceTraits<T, std::enable_if_t<T::k_has_pieces>>
+{
+  static size_t ALGORITHMS_CC PieceSummarySize(HashContext* ctx, uint64_t offset, size_t size)
+  {
+    return ((T*)ctx)->PieceSummarySize(offset, size);
+  }
+
+  static void ALGORITHMS_CC HashPiece(HashContext* ctx, uint64_t offset, const void* data, size_t size, uint8_t* summary)
+  {
+    ((T*)ctx)->HashPiece(offset, data, size, summary);
+  }
+
+  static void ALGORITHMS_CC AbsorbPiece(HashContext* ctx, uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    ((T*)ctx)->AbsorbPiece(offset, size, summary);
+  }
+
+public:
+  static constexpr auto piece_summary_size_fn = &PieceSummarySize;
+  static constexpr auto hash_piece_fn = &HashPiece;
+  static constexpr auto absorb_piece_fn = &AbsorbPiece;
+  static constexpr size_t piece_size = k_piece_size_of<T>;
+};
+
+template <typename T, class = void>
+class AbsorbTraits
+{
+public:
+  static constexpr auto absorb_from_fn = nullptr;
+  static constexpr const char* absorb_family = nullptr;
+};
+
+template <typename T>
+class AbsorbTraits<T, std::void_t<decltype(T::k_absorb_family)>>
+{
+  static void ALGORITHMS_CC AbsorbFrom(HashContext* ctx, const HashContext* other)
+  {
+    ((T*)ctx)->AbsorbFrom(other);
+  }
+
+public:
+  static constexpr auto absorb_from_fn = &AbsorbFrom;
+  static constexpr const char* absorb_family = T::k_absorb_family;
+};
+
 template <typename T, class = void>
 class HashContextTraits
 {
@@ -814,7 +1375,7 @@ public:
 };
 
 template <typename T>
-constexpr HashAlgorithm make_algorithm(const char* name, bool is_secure)
+constexpr HashAlgorithm make_algorithm(const char* name, bool is_secure, uint32_t cost)
 {
   return HashAlgorithm{
     HashContextTraits<T>::param_check_fn,
@@ -823,45 +1384,60 @@ constexpr HashAlgorithm make_algorithm(const char* name, bool is_secure)
     HashContextTraits<T>::factory_fn,
     HashContextTraits<T>::update_fn,
     HashContextTraits<T>::finish_fn,
+    UpdateManyTraits<T>::update_many_fn,
+    PieceTraits<T>::piece_summary_size_fn,
+    PieceTraits<T>::hash_piece_fn,
+    PieceTraits<T>::absorb_piece_fn,
+    PieceTraits<T>::piece_size,
+    AbsorbTraits<T>::absorb_from_fn,
+    AbsorbTraits<T>::absorb_family,
     HashContextTraits<T>::get_output_size_fn,
     HashContextTraits<T>::delete_fn,
     name,
     is_secure,
+    cost,
     HashContextTraits<T>::params,
     HashContextTraits<T>::params_count
   };
 }
 
 constexpr HashAlgorithm k_algorithms[] = {
-  make_algorithm<Crc32HashContext>("CRC32", false),
-  make_algorithm<Crc64HashContext>("CRC64", false),
-  make_algorithm<XXH32HashContext>("XXH32", false),
-  make_algorithm<XXH64HashContext>("XXH64", false),
-  make_algorithm<XXH3_64bitsHashContext>("XXH3-64", false),
-  make_algorithm<XXH3_128bitsHashContext>("XXH3-128", false),
-  make_algorithm<Md4HashContext>("MD4", false),
-  make_algorithm<Md5HashContext>("MD5", false),
-  make_algorithm<RipeMD160HashContext>("RipeMD160", true),
-  make_algorithm<Sha1HashContext>("SHA-1", true),
-  make_algorithm<Sha224HashContext>("SHA-224", true),
-  make_algorithm<Sha256HashContext>("SHA-256", true),
-  make_algorithm<Sha384HashContext>("SHA-384", true),
-  make_algorithm<Sha512HashContext>("SHA-512", true),
-  make_algorithm<Blake2SpHashContext>("BLAKE2sp", true),
-  make_algorithm<KeccakHashContext>("Keccak", true),
-  make_algorithm<KangarooTwelveHashContext>("K12", true),
-  make_algorithm<ParallelHash128HashContext>("PH128", true),
-  make_algorithm<ParallelHash256HashContext>("PH256", true),
-  make_algorithm<Blake3HashContext>("BLAKE3", true),
-  make_algorithm<GOST34112012_256HashContext>("GOST 2012 (256)", true),
-  make_algorithm<GOST34112012_512HashContext>("GOST 2012 (512)", true),
-  make_algorithm<ED2kHashContext<false>>("eD2k", false),
-  make_algorithm<ED2kHashContext<true>>("eD2k (Old)", false),
-  make_algorithm<QuickXorHashContext>("QuickXorHash", false),
+  make_algorithm<Crc32HashContext>("CRC32", false, 1000),
+  make_algorithm<Crc64HashContext>("CRC64", false, 1200),
+  make_algorithm<XXH32HashContext>("XXH32", false, 250),
+  make_algorithm<XXH64HashContext>("XXH64", false, 150),
+  make_algorithm<XXH3_64bitsHashContext>("XXH3-64", false, 60),
+  make_algorithm<XXH3_128bitsHashContext>("XXH3-128", false, 60),
+  make_algorithm<Md4HashContext>("MD4", false, 2500),
+  make_algorithm<Md5HashContext>("MD5", false, 5000),
+  make_algorithm<RipeMD160HashContext>("RipeMD160", true, 7000),
+  make_algorithm<Sha1HashContext>("SHA-1", true, 4500),
+  make_algorithm<Sha224HashContext>("SHA-224", true, 10000),
+  make_algorithm<Sha256HashContext>("SHA-256", true, 10000),
+  make_algorithm<Sha384HashContext>("SHA-384", true, 7000),
+  make_algorithm<Sha512HashContext>("SHA-512", true, 7000),
+  make_algorithm<Blake2SpHashContext>("BLAKE2sp", true, 3000),
+  make_algorithm<KeccakHashContext>("Keccak", true, 12000),
+  make_algorithm<KangarooTwelveHashContext>("K12", true, 2000),
+  make_algorithm<ParallelHash128HashContext>("PH128", true, 4000),
+  make_algorithm<ParallelHash256HashContext>("PH256", true, 6000),
+  make_algorithm<Blake3HashContext>("BLAKE3", true, 600),
+  make_algorithm<GOST34112012_256HashContext>("GOST 2012 (256)", true, 30000),
+  make_algorithm<GOST34112012_512HashContext>("GOST 2012 (512)", true, 30000),
+  make_algorithm<ED2kHashContext<false>>("eD2k", false, 2500),
+  make_algorithm<ED2kHashContext<true>>("eD2k (Old)", false, 2500),
+  make_algorithm<QuickXorHashContext>("QuickXorHash", false, 1500),
 };
 
 constexpr const HashAlgorithm* k_algorithms_begin = std::begin(k_algorithms);
 constexpr const HashAlgorithm* k_algorithms_end = std::end(k_algorithms);
 
-extern "C" const HashAlgorithm* get_algorithms_begin() { return k_algorithms_begin; }
-extern "C" const HashAlgorithm* get_algorithms_end() { return k_algorithms_end; }
+// On Windows the flavor suffixed exports are added by the linker
+#if defined(_WIN32)
+#define ALGORITHMS_EXPORT
+#else
+#define ALGORITHMS_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" ALGORITHMS_EXPORT const HashAlgorithm* get_algorithms_begin() { return k_algorithms_begin; }
+extern "C" ALGORITHMS_EXPORT const HashAlgorithm* get_algorithms_end() { return k_algorithms_end; }
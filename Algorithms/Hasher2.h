@@ -17,10 +17,16 @@
 #include <cstdint>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 
+#if defined(_WIN32)
 #define ALGORITHMS_CC __stdcall
+#else
+#define ALGORITHMS_CC
+#endif
 
 class HashContext;
+class HashBox;
 
 class HashAlgorithm
 {
@@ -31,6 +37,16 @@ class HashAlgorithm
 
   using UpdateFn = void ALGORITHMS_CC(HashContext* ctx, const void* data, size_t size);
   using FinishFn = void ALGORITHMS_CC(HashContext* ctx, uint8_t* out);
+  // Update count contexts of this algorithm, maybe with different params, each with its own data
+  using UpdateManyFn = void ALGORITHMS_CC(HashContext* const* ctxs, const void* const* data, const size_t* sizes, size_t count);
+  // Pieces are runs of a message that are hashed apart from the context, possibly on other threads, into a summary
+  // that's absorbed into the context in order later. Returns the summary size, 0 if the run can't be a piece
+  using PieceSummarySizeFn = size_t ALGORITHMS_CC(HashContext* ctx, uint64_t offset, size_t size);
+  using HashPieceFn = void ALGORITHMS_CC(HashContext* ctx, uint64_t offset, const void* data, size_t size, uint8_t* summary);
+  using AbsorbPieceFn = void ALGORITHMS_CC(HashContext* ctx, uint64_t offset, size_t size, const uint8_t* summary);
+  // Contexts of the same absorb family, maybe of different algorithms or params, absorb a message the same way and
+  // only differ in how they finish. Makes ctx as if it was fed everything other was
+  using AbsorbFromFn = void ALGORITHMS_CC(HashContext* ctx, const HashContext* other);
   using GetOutputSizeFn = size_t ALGORITHMS_CC(HashContext* ctx);
 
   using DeleteFn = void ALGORITHMS_CC(HashContext* ctx);
@@ -41,6 +57,13 @@ class HashAlgorithm
   FactoryFn* _factory_fn;
   UpdateFn* _update_fn;
   FinishFn* _finish_fn;
+  UpdateManyFn* _update_many_fn; // optional, for algorithms that can hash several messages at once
+  PieceSummarySizeFn* _piece_summary_size_fn; // optional, along with the two below
+  HashPieceFn* _hash_piece_fn;
+  AbsorbPieceFn* _absorb_piece_fn;
+  size_t _piece_size; // smallest piece worth hashing apart, 0 if any
+  AbsorbFromFn* _absorb_from_fn; // optional, along with the family
+  const char* _absorb_family;
   GetOutputSizeFn* _get_output_size_fn;
   DeleteFn* _delete_fn;
 
@@ -49,6 +72,7 @@ public:
   const char* const* params;
   uint32_t params_size;
   bool is_secure;
+  uint32_t cost; // rough cycles per kilobyte on a single core, used for scheduling
 
   HashBox MakeContext(const uint64_t* params) const;
   size_t ParamCheck(const uint64_t* _params) const { return _param_check_fn(_params); }
@@ -60,10 +84,18 @@ public:
     FactoryFn* factory_fn,
     UpdateFn* update_fn,
     FinishFn* finish_fn,
+    UpdateManyFn* update_many_fn,
+    PieceSummarySizeFn* piece_summary_size_fn,
+    HashPieceFn* hash_piece_fn,
+    AbsorbPieceFn* absorb_piece_fn,
+    size_t piece_size,
+    AbsorbFromFn* absorb_from_fn,
+    const char* absorb_family,
     GetOutputSizeFn* get_output_size_fn,
     DeleteFn* delete_fn,
     const char* name,
     bool is_secure,
+    uint32_t cost,
     const char* const* params,
     uint32_t params_size
   ) : _param_check_fn(param_check_fn)
@@ -72,12 +104,20 @@ public:
     , _factory_fn(factory_fn)
     , _update_fn(update_fn)
     , _finish_fn(finish_fn)
+    , _update_many_fn(update_many_fn)
+    , _piece_summary_size_fn(piece_summary_size_fn)
+    , _hash_piece_fn(hash_piece_fn)
+    , _absorb_piece_fn(absorb_piece_fn)
+    , _piece_size(piece_size)
+    , _absorb_from_fn(absorb_from_fn)
+    , _absorb_family(absorb_family)
     , _get_output_size_fn(get_output_size_fn)
     , _delete_fn(delete_fn)
     , name(name)
     , params(params)
     , params_size(params_size)
-    , is_secure(is_secure) {}
+    , is_secure(is_secure)
+    , cost(cost) {}
 
   template <size_t N>
   constexpr HashAlgorithm(
@@ -87,10 +127,18 @@ public:
     FactoryFn* factory_fn,
     UpdateFn* update_fn,
     FinishFn* finish_fn,
+    UpdateManyFn* update_many_fn,
+    PieceSummarySizeFn* piece_summary_size_fn,
+    HashPieceFn* hash_piece_fn,
+    AbsorbPieceFn* absorb_piece_fn,
+    size_t piece_size,
+    AbsorbFromFn* absorb_from_fn,
+    const char* absorb_family,
     GetOutputSizeFn* get_output_size_fn,
     DeleteFn* delete_fn,
     const char* name,
     bool is_secure,
+    uint32_t cost,
     const char* const(&params)[N]
   ) : _param_check_fn(param_check_fn)
     , _ctx_size(ctx_size)
@@ -98,30 +146,58 @@ public:
     , _factory_fn(factory_fn)
     , _update_fn(update_fn)
     , _finish_fn(finish_fn)
+    , _update_many_fn(update_many_fn)
+    , _piece_summary_size_fn(piece_summary_size_fn)
+    , _hash_piece_fn(hash_piece_fn)
+    , _absorb_piece_fn(absorb_piece_fn)
+    , _piece_size(piece_size)
+    , _absorb_from_fn(absorb_from_fn)
+    , _absorb_family(absorb_family)
     , _get_output_size_fn(get_output_size_fn)
     , _delete_fn(delete_fn)
     , name(name)
     , params(params)
     , params_size(N)
-    , is_secure(is_secure) {}
+    , is_secure(is_secure)
+    , cost(cost) {}
 };
 
 class HashBox
 {
+  // Fits in L1 on most processors, and comfortably in L2 on all of them
+  static constexpr size_t k_fused_tile_size = 32 << 10;
+
   const HashAlgorithm* _algorithm{};
   HashContext* _ctx{};
 
+  static void* AlignedAlloc(size_t size, size_t align) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, align);
+#else
+    void* p{};
+    return posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size) ? nullptr : p;
+#endif
+  }
+
+  static void AlignedFree(void* p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+  }
+
 public:
   constexpr HashBox() {}
 
   HashBox(const HashAlgorithm& algorithm, const uint64_t* params)
     : _algorithm(&algorithm)
-    , _ctx(_algorithm->_factory_fn(_aligned_malloc(_algorithm->_ctx_size, _algorithm->_ctx_align), params)) {}
+    , _ctx(_algorithm->_factory_fn(AlignedAlloc(_algorithm->_ctx_size, _algorithm->_ctx_align), params)) {}
 
   ~HashBox() {
     if(_ctx)
       _algorithm->_delete_fn(_ctx);
-    _aligned_free(_ctx);
+    AlignedFree(_ctx);
   }
 
   HashBox(const HashBox&) = delete;
@@ -147,11 +223,11 @@ public:
   {
     if (_ctx) {
       _algorithm->_delete_fn(_ctx);
-      _aligned_free(_ctx);
+      AlignedFree(_ctx);
       _ctx = nullptr;
     }
     _algorithm = &algorithm;
-    _ctx = _algorithm->_factory_fn(_aligned_malloc(_algorithm->_ctx_size, _algorithm->_ctx_align) ,params);
+    _ctx = _algorithm->_factory_fn(AlignedAlloc(_algorithm->_ctx_size, _algorithm->_ctx_align) ,params);
   }
 
   bool IsInitialized() const { return _ctx != nullptr; }
@@ -159,6 +235,87 @@ public:
   void Update(const void* data, size_t size) { _algorithm->_update_fn(_ctx, data, size); }
   void Finish(uint8_t* out) { _algorithm->_finish_fn(_ctx, out); }
   size_t GetOutputSize() const { return _algorithm->_get_output_size_fn(_ctx); }
+
+  // Pieces never include the end of the message, that always goes through
+  // Update. Hashing a piece only reads the params of the box, so it's safe to
+  // do from any number of threads, even while the box is updated.
+  bool HasPieces() const { return _algorithm->_piece_summary_size_fn != nullptr; }
+  // Pieces should be at least this big, and start at multiples of it. 0 if the size doesn't matter
+  size_t PieceSize() const { return _algorithm->_piece_size; }
+  size_t PieceSummarySize(uint64_t offset, size_t size) const
+  {
+    return HasPieces() ? _algorithm->_piece_summary_size_fn(_ctx, offset, size) : 0;
+  }
+  void HashPiece(uint64_t offset, const void* data, size_t size, uint8_t* summary) const
+  {
+    _algorithm->_hash_piece_fn(_ctx, offset, data, size, summary);
+  }
+  // Pieces must be absorbed in order, and offset must be where the box is at
+  void AbsorbPiece(uint64_t offset, size_t size, const uint8_t* summary)
+  {
+    _algorithm->_absorb_piece_fn(_ctx, offset, size, summary);
+  }
+
+  bool SameAlgorithm(const HashBox& other) const { return _algorithm == other._algorithm; }
+
+  // Boxes that share absorption only need one of them fed the message, the
+  // others can take it over right before finishing
+  bool SharesAbsorption(const HashBox& other) const
+  {
+    const auto family = _algorithm->_absorb_family;
+    const auto other_family = other._algorithm->_absorb_family;
+    return family && other_family && 0 == strcmp(family, other_family);
+  }
+  // Take over everything other absorbed so far, it must share absorption
+  void AbsorbFrom(const HashBox& other)
+  {
+    _algorithm->_absorb_from_fn(_ctx, other._ctx);
+  }
+
+  // Update several boxes with the same data. It's walked in tiles small enough
+  // to stay in cache while every box hashes them, so it's only pulled in once
+  static void UpdateFused(HashBox* const* boxes, size_t count, const void* data, size_t size)
+  {
+    if (count == 1)
+    {
+      boxes[0]->Update(data, size);
+      return;
+    }
+
+    const auto bytes = (const uint8_t*)data;
+    for (size_t offset = 0; offset < size; offset += k_fused_tile_size)
+    {
+      const auto tile = size - offset < k_fused_tile_size ? size - offset : k_fused_tile_size;
+      for (size_t i = 0; i < count; ++i)
+        boxes[i]->Update(bytes + offset, tile);
+    }
+  }
+
+  // Update boxes of the same algorithm, each with its own data. Algorithms
+  // with multi-buffer kernels hash them side by side, even if params differ
+  static void UpdateMany(HashBox* const* boxes, const void* const* data, const size_t* sizes, size_t count)
+  {
+    if (!count)
+      return;
+
+    const auto algorithm = boxes[0]->_algorithm;
+    if (!algorithm->_update_many_fn)
+    {
+      for (size_t i = 0; i < count; ++i)
+        boxes[i]->Update(data[i], sizes[i]);
+      return;
+    }
+
+    constexpr size_t k_chunk = 64;
+    HashContext* ctxs[k_chunk];
+    for (size_t done = 0; done < count; done += k_chunk)
+    {
+      const auto n = count - done < k_chunk ? count - done : k_chunk;
+      for (size_t i = 0; i < n; ++i)
+        ctxs[i] = boxes[done + i]->_ctx;
+      algorithm->_update_many_fn(ctxs, data + done, sizes + done, n);
+    }
+  }
 };
 
 inline HashBox HashAlgorithm::MakeContext(const uint64_t* params_) const
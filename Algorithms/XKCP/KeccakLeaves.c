@@ -0,0 +1,113 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "KeccakLeaves.h"
+
+#include "KeccakP-1600-SnP.h"
+#include "KeccakSponge.h"
+#include "TurboSHAKE.h"
+#include "KeccakTimesN.h"
+
+#define laneSize 8
+#define K12_rateInBytes 168
+#define K12_suffixLeaf 0x0B /* '110': message hop, simple padding, inner node */
+#define SHAKE128_rateInBytes 168
+#define SHAKE256_rateInBytes 136
+#define SHAKE_suffix 0x1F
+
+static void HashLeaf(int twelveRounds, unsigned int rateInBytes, unsigned char suffix, unsigned int cvLen,
+                     const unsigned char *input, size_t leafLen, unsigned char *cv)
+{
+    const unsigned int rounds = twelveRounds ? 12 : 24;
+    KeccakP1600_state state;
+
+    KeccakP1600_Initialize(&state);
+    for ( ; leafLen >= rateInBytes; input += rateInBytes, leafLen -= rateInBytes) {
+        KeccakP1600_AddBytes(&state, input, 0, rateInBytes);
+        KeccakP1600_Permute_Nrounds(&state, rounds);
+    }
+    KeccakP1600_AddBytes(&state, input, 0, (unsigned int)leafLen);
+    KeccakP1600_AddByte(&state, suffix, (unsigned int)leafLen);
+    KeccakP1600_AddByte(&state, 0x80, rateInBytes - 1);
+    KeccakP1600_Permute_Nrounds(&state, rounds);
+    KeccakP1600_ExtractBytes(&state, cv, 0, cvLen);
+}
+
+static void HashLeaves(int twelveRounds, unsigned int rateInBytes, unsigned char suffix, unsigned int cvLen,
+                       const unsigned char *input, size_t leafLen, size_t leafCount, unsigned char *cvs)
+{
+    size_t done = 0;
+
+    /* The parallel fast loops address the leaves in whole lanes */
+    if (leafLen % laneSize == 0 && leafLen / laneSize <= (unsigned int)-1) {
+        const KeccakTimesN *const *timesN;
+        for (timesN = KeccakTimesN_Available(); *timesN; ++timesN)
+            done += (*timesN)->HashLeaves(twelveRounds, rateInBytes, suffix, cvLen, input + done * leafLen, leafLen, leafCount - done, cvs + done * cvLen);
+    }
+    for ( ; done < leafCount; ++done)
+        HashLeaf(twelveRounds, rateInBytes, suffix, cvLen, input + done * leafLen, leafLen, cvs + done * cvLen);
+}
+
+void KangarooTwelve_HashLeaves(const unsigned char *input, size_t leafCount, unsigned char *cvs)
+{
+    HashLeaves(1, K12_rateInBytes, K12_suffixLeaf, KangarooTwelve_leafCVLen, input, KangarooTwelve_leafLen, leafCount, cvs);
+}
+
+void ParallelHash128_HashLeaves(const unsigned char *input, size_t blockLen, size_t leafCount, unsigned char *cvs)
+{
+    HashLeaves(0, SHAKE128_rateInBytes, SHAKE_suffix, ParallelHash128_leafCVLen, input, blockLen, leafCount, cvs);
+}
+
+void ParallelHash256_HashLeaves(const unsigned char *input, size_t blockLen, size_t leafCount, unsigned char *cvs)
+{
+    HashLeaves(0, SHAKE256_rateInBytes, SHAKE_suffix, ParallelHash256_leafCVLen, input, blockLen, leafCount, cvs);
+}
+
+int KangarooTwelve_AbsorbLeaves(KangarooTwelve_Instance *ktInstance, const unsigned char *cvs, size_t leafCount)
+{
+    if (ktInstance->blockNumber == 0) {
+        /* The first leaf is complete, but Update only closes it once more
+         * input arrives: '110^6' then zero padding up to 64 bits */
+        static const unsigned char padding[laneSize] = { 0x03 };
+        if (ktInstance->queueAbsorbedLen != KangarooTwelve_leafLen)
+            return 1;
+        if (TurboSHAKE_Absorb(&ktInstance->finalNode, padding, sizeof(padding)) != 0)
+            return 1;
+        ktInstance->queueAbsorbedLen = 0;
+        ktInstance->blockNumber = 1;
+    }
+    else if (ktInstance->queueAbsorbedLen != 0)
+        return 1;
+    ktInstance->blockNumber += leafCount;
+    return TurboSHAKE_Absorb(&ktInstance->finalNode, cvs, leafCount * KangarooTwelve_leafCVLen);
+}
+
+static int ParallelHash_AbsorbLeaves(ParallelHash_Instance *ParallelHashInstance, const unsigned char *cvs, size_t leafCount, unsigned int cvLen)
+{
+    if (ParallelHashInstance->queueAbsorbedLen != 0)
+        return 1;
+    ParallelHashInstance->totalInputSize += leafCount * ParallelHashInstance->blockLen;
+    return KeccakWidth1600_SpongeAbsorb(&ParallelHashInstance->finalNode, cvs, leafCount * cvLen);
+}
+
+int ParallelHash128_AbsorbLeaves(ParallelHash_Instance *ParallelHashInstance, const unsigned char *cvs, size_t leafCount)
+{
+    return ParallelHash_AbsorbLeaves(ParallelHashInstance, cvs, leafCount, ParallelHash128_leafCVLen);
+}
+
+int ParallelHash256_AbsorbLeaves(ParallelHash_Instance *ParallelHashInstance, const unsigned char *cvs, size_t leafCount)
+{
+    return ParallelHash_AbsorbLeaves(ParallelHashInstance, cvs, leafCount, ParallelHash256_leafCVLen);
+}
@@ -0,0 +1,60 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#ifndef EXTERN_C_START
+#ifdef __cplusplus
+#define EXTERN_C_START extern "C" {
+#define EXTERN_C_END }
+#else
+#define EXTERN_C_START
+#define EXTERN_C_END
+#endif
+#endif
+
+EXTERN_C_START
+
+#include <stddef.h>
+
+#include "KangarooTwelve.h"
+#include "SP800-185.h"
+
+// Hashing runs of whole leaves of KangarooTwelve and ParallelHash apart from
+// the instance, possibly on another thread, then absorbing their chaining
+// values into the final node when the instance gets there. This is the same
+// split the Update functions do, so the digest does not change.
+//
+// A run must not be the end of the message, the last leaf always goes through
+// Update.
+
+#define KangarooTwelve_leafLen 8192
+#define KangarooTwelve_leafCVLen 32
+#define ParallelHash128_leafCVLen 32
+#define ParallelHash256_leafCVLen 64
+
+// Write the chaining values of leafCount leaves read back to back from input
+void KangarooTwelve_HashLeaves(const unsigned char *input, size_t leafCount, unsigned char *cvs);
+void ParallelHash128_HashLeaves(const unsigned char *input, size_t blockLen, size_t leafCount, unsigned char *cvs);
+void ParallelHash256_HashLeaves(const unsigned char *input, size_t blockLen, size_t leafCount, unsigned char *cvs);
+
+// Absorb chaining values of leaves starting right where the instance is. A
+// KangarooTwelve instance must have taken whole leaves past the first one, a
+// ParallelHash instance must have taken whole blocks.
+int KangarooTwelve_AbsorbLeaves(KangarooTwelve_Instance *ktInstance, const unsigned char *cvs, size_t leafCount);
+int ParallelHash128_AbsorbLeaves(ParallelHash_Instance *ParallelHashInstance, const unsigned char *cvs, size_t leafCount);
+int ParallelHash256_AbsorbLeaves(ParallelHash_Instance *ParallelHashInstance, const unsigned char *cvs, size_t leafCount);
+
+EXTERN_C_END
@@ -0,0 +1,34 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "KeccakMany.h"
+
+#include "KeccakTimesN.h"
+
+void KeccakWidth1600_SpongeAbsorbMany(KeccakWidth1600_Stream *streams, size_t count)
+{
+    /* Lanes that run dry are refilled at once, so only the widest one is used */
+    const KeccakTimesN *widest = *KeccakTimesN_Available();
+    size_t i;
+
+    if (widest)
+        widest->AbsorbMany(streams, count);
+    for (i = 0; i < count; ++i) {
+        const size_t rateInBytes = streams[i].sponge->rate / 8;
+        KeccakWidth1600_SpongeAbsorb(streams[i].sponge, streams[i].data, streams[i].blocks * rateInBytes);
+        streams[i].data += streams[i].blocks * rateInBytes;
+        streams[i].blocks = 0;
+    }
+}
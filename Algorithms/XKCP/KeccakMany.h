@@ -0,0 +1,50 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#ifndef EXTERN_C_START
+#ifdef __cplusplus
+#define EXTERN_C_START extern "C" {
+#define EXTERN_C_END }
+#else
+#define EXTERN_C_START
+#define EXTERN_C_END
+#endif
+#endif
+
+EXTERN_C_START
+
+#include <stddef.h>
+
+#include "KeccakSponge.h"
+
+// Absorbing several independent messages at once, one message per instance of
+// the parallel permutations. Only whole blocks are absorbed, buffering and
+// padding is left to the sponges themselves.
+
+typedef struct {
+    KeccakWidth1600_SpongeInstance *sponge;
+    const unsigned char *data;
+    size_t blocks;
+} KeccakWidth1600_Stream;
+
+// Absorb each stream's blocks into its sponge, which must be at a block
+// boundary and not squeezing yet. Streams can be of any length, in any number
+// and with any rate, they are scheduled onto instances as others run out of
+// blocks. Without a parallel permutation these absorb one stream at a time.
+void KeccakWidth1600_SpongeAbsorbMany(KeccakWidth1600_Stream *streams, size_t count);
+
+EXTERN_C_END
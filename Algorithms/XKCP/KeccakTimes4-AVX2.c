@@ -13,6 +13,12 @@
 //
 //    You should have received a copy of the GNU General Public License
 //    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
-#include "Queues.h"
+#define KeccakTimesN_parallelism 4
+#define KeccakTimesN_variant AVX2
 
-moodycamel::ConcurrentQueue<FileHashTask*> g_read_queue;
+#include "XKCP/lib/low/KeccakP-1600-times4/AVX2/KeccakP-1600-times4-SnP.h"
+#include "KeccakTimesNRename.h"
+#include "XKCP/lib/low/KeccakP-1600-times4/AVX2/KeccakP-1600-times4-SIMD256.c"
+#include "KeccakTimesNDefine.h"
+
+DefineKeccakTimesN(4, AVX2)
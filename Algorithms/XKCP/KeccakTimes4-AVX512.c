@@ -13,17 +13,12 @@
 //
 //    You should have received a copy of the GNU General Public License
 //    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
-#pragma once
+#define KeccakTimesN_parallelism 4
+#define KeccakTimesN_variant AVX512
 
+#include "XKCP/lib/low/KeccakP-1600-times4/AVX512/KeccakP-1600-times4-SnP.h"
+#include "KeccakTimesNRename.h"
+#include "XKCP/lib/low/KeccakP-1600-times4/AVX512/KeccakP-1600-times4-SIMD512.c"
+#include "KeccakTimesNDefine.h"
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wall"
-#pragma clang diagnostic ignored "-Wsuggest-destructor-override"
-#pragma clang diagnostic ignored "-Wsign-conversion"
-#include <blockingconcurrentqueue.h>
-#pragma clang diagnostic pop
-
-
-class FileHashTask;
-
-extern moodycamel::ConcurrentQueue<FileHashTask*> g_read_queue;
+DefineKeccakTimesN(4, AVX512)
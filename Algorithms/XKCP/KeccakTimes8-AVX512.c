@@ -0,0 +1,24 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#define KeccakTimesN_parallelism 8
+#define KeccakTimesN_variant AVX512
+
+#include "XKCP/lib/low/KeccakP-1600-times8/AVX512/KeccakP-1600-times8-SnP.h"
+#include "KeccakTimesNRename.h"
+#include "XKCP/lib/low/KeccakP-1600-times8/AVX512/KeccakP-1600-times8-SIMD512.c"
+#include "KeccakTimesNDefine.h"
+
+DefineKeccakTimesN(8, AVX512)
@@ -0,0 +1,40 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "KeccakTimesN.h"
+
+#if defined(OHT_RUNTIME_DISPATCH)
+#include <cpufeatures.h>
+
+extern const KeccakTimesN KeccakP1600times4_AVX2;
+extern const KeccakTimesN KeccakP1600times4_AVX512;
+extern const KeccakTimesN KeccakP1600times8_AVX512;
+
+static const KeccakTimesN *const AVX512[] = { &KeccakP1600times8_AVX512, &KeccakP1600times4_AVX512, NULL };
+static const KeccakTimesN *const AVX2[] = { &KeccakP1600times4_AVX2, NULL };
+#endif
+
+static const KeccakTimesN *const none[] = { NULL };
+
+const KeccakTimesN *const *KeccakTimesN_Available(void)
+{
+#if defined(OHT_RUNTIME_DISPATCH)
+    if (cpu_has(CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512VL))
+        return AVX512;
+    if (cpu_has(CPU_FEATURE_AVX2))
+        return AVX2;
+#endif
+    return none;
+}
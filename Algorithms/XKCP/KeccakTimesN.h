@@ -0,0 +1,35 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <stddef.h>
+
+#include "KeccakMany.h"
+
+/* The parallel Keccak-p[1600] permutations built for wider instruction sets
+ * than the flavor, each in its own file, picked at runtime. */
+typedef struct {
+    unsigned int parallelism;
+    /* Hashes whole groups of leaves and returns how many it did */
+    size_t (*HashLeaves)(int twelveRounds, unsigned int rateInBytes, unsigned char suffix, unsigned int cvLen,
+                         const unsigned char *input, size_t leafLen, size_t leafCount, unsigned char *cvs);
+    /* Absorbs the streams' blocks, except for what's best left to the plain
+     * permutation */
+    void (*AbsorbMany)(KeccakWidth1600_Stream *streams, size_t count);
+} KeccakTimesN;
+
+/* The ones this CPU can run, widest first and terminated by NULL */
+const KeccakTimesN *const *KeccakTimesN_Available(void);
@@ -0,0 +1,136 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+/* Included after the implementation of a parallel permutation, to build its
+ * KeccakTimesN entry on it. */
+
+#include "KeccakP-1600-SnP.h"
+#include "KeccakSponge.h"
+#include "KeccakTimesN.h"
+
+#define KeccakTimesN_laneSize 8
+#define KeccakTimesN_stateSizeInBytes 200
+
+/* The leaves are independent sponges that only differ in their input, so
+ * they map directly onto the parallel permutations, the same way the Update
+ * functions use them. */
+#define DefineHashLeavesTimesN(Parallelism) \
+static size_t HashLeavesTimes##Parallelism(int twelveRounds, unsigned int rateInBytes, unsigned char suffix, unsigned int cvLen, \
+                                           const unsigned char *input, size_t leafLen, size_t leafCount, unsigned char *cvs) \
+{ \
+    size_t done = 0; \
+    KeccakP1600times##Parallelism##_StaticInitialize(); \
+    for ( ; leafCount - done >= Parallelism; done += Parallelism) { \
+        KeccakP1600times##Parallelism##_states states; \
+        const unsigned char *leaves = input + done * leafLen; \
+        size_t offset; \
+        unsigned int tail, i; \
+        \
+        KeccakP1600times##Parallelism##_InitializeAll(&states); \
+        if (twelveRounds) \
+            offset = KeccakP1600times##Parallelism##_12rounds_FastLoop_Absorb(&states, rateInBytes / KeccakTimesN_laneSize, (unsigned int)(leafLen / KeccakTimesN_laneSize), \
+                                                                              rateInBytes / KeccakTimesN_laneSize, leaves, Parallelism * leafLen); \
+        else \
+            offset = KeccakF1600times##Parallelism##_FastLoop_Absorb(&states, rateInBytes / KeccakTimesN_laneSize, (unsigned int)(leafLen / KeccakTimesN_laneSize), \
+                                                                     rateInBytes / KeccakTimesN_laneSize, leaves, Parallelism * leafLen); \
+        tail = (unsigned int)(leafLen - offset); \
+        for (i = 0; i < Parallelism; ++i) { \
+            KeccakP1600times##Parallelism##_AddBytes(&states, i, leaves + i * leafLen + offset, 0, tail); \
+            KeccakP1600times##Parallelism##_AddByte(&states, i, suffix, tail); \
+            KeccakP1600times##Parallelism##_AddByte(&states, i, 0x80, rateInBytes - 1); \
+        } \
+        if (twelveRounds) \
+            KeccakP1600times##Parallelism##_PermuteAll_12rounds(&states); \
+        else \
+            KeccakP1600times##Parallelism##_PermuteAll_24rounds(&states); \
+        KeccakP1600times##Parallelism##_ExtractLanesAll(&states, cvs + done * cvLen, cvLen / KeccakTimesN_laneSize, cvLen / KeccakTimesN_laneSize); \
+    } \
+    return done; \
+}
+
+/* The states move between the sponges and the parallel instances in their
+ * byte representation, as each permutation may keep them in its own layout.
+ * Every instance takes as much of a block as its own sponge's rate, the
+ * permutation doesn't care. */
+#define DefineAbsorbManyTimesN(Parallelism) \
+static void AbsorbManyTimes##Parallelism(KeccakWidth1600_Stream *streams, size_t count) \
+{ \
+    KeccakP1600times##Parallelism##_states states; \
+    KeccakWidth1600_Stream *lanes[Parallelism] = { 0 }; \
+    unsigned char state[KeccakTimesN_stateSizeInBytes]; \
+    size_t next = 0; \
+    unsigned int active = 0, i; \
+    \
+    KeccakP1600times##Parallelism##_StaticInitialize(); \
+    KeccakP1600times##Parallelism##_InitializeAll(&states); \
+    for (;;) { \
+        size_t blocks = (size_t)-1; \
+        size_t block; \
+        \
+        for (i = 0; i < Parallelism; ++i) { \
+            if (lanes[i] && !lanes[i]->blocks) { \
+                KeccakP1600times##Parallelism##_ExtractBytes(&states, i, state, 0, KeccakTimesN_stateSizeInBytes); \
+                KeccakP1600_OverwriteBytes(&lanes[i]->sponge->state, state, 0, KeccakTimesN_stateSizeInBytes); \
+                lanes[i] = NULL; \
+                --active; \
+            } \
+            for ( ; !lanes[i] && next < count; ++next) { \
+                if (!streams[next].blocks) \
+                    continue; \
+                KeccakP1600_ExtractBytes(&streams[next].sponge->state, state, 0, KeccakTimesN_stateSizeInBytes); \
+                KeccakP1600times##Parallelism##_OverwriteBytes(&states, i, state, 0, KeccakTimesN_stateSizeInBytes); \
+                lanes[i] = &streams[next]; \
+                ++active; \
+            } \
+            if (lanes[i] && lanes[i]->blocks < blocks) \
+                blocks = lanes[i]->blocks; \
+        } \
+        \
+        /* A stream left on its own is faster on the plain permutation */ \
+        if (active < 2 && next == count) \
+            break; \
+        \
+        for (block = 0; block < blocks; ++block) { \
+            for (i = 0; i < Parallelism; ++i) { \
+                if (lanes[i]) { \
+                    const unsigned int rateInBytes = lanes[i]->sponge->rate / 8; \
+                    KeccakP1600times##Parallelism##_AddBytes(&states, i, lanes[i]->data, 0, rateInBytes); \
+                    lanes[i]->data += rateInBytes; \
+                } \
+            } \
+            KeccakP1600times##Parallelism##_PermuteAll_24rounds(&states); \
+        } \
+        for (i = 0; i < Parallelism; ++i) \
+            if (lanes[i]) \
+                lanes[i]->blocks -= blocks; \
+    } \
+    \
+    for (i = 0; i < Parallelism; ++i) { \
+        if (lanes[i]) { \
+            KeccakP1600times##Parallelism##_ExtractBytes(&states, i, state, 0, KeccakTimesN_stateSizeInBytes); \
+            KeccakP1600_OverwriteBytes(&lanes[i]->sponge->state, state, 0, KeccakTimesN_stateSizeInBytes); \
+        } \
+    } \
+}
+
+/* Defines the table entry for the permutation, after its implementation */
+#define DefineKeccakTimesN(Parallelism, Variant) \
+DefineHashLeavesTimesN(Parallelism) \
+DefineAbsorbManyTimesN(Parallelism) \
+const KeccakTimesN KeccakP1600times##Parallelism##_##Variant = { \
+    Parallelism, \
+    &HashLeavesTimes##Parallelism, \
+    &AbsorbManyTimes##Parallelism \
+};
@@ -0,0 +1,153 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+/* Included by the files that build a parallel permutation for a wider
+ * instruction set, between its SnP header and its implementation. The other
+ * builds of the permutation export the same names, so this one's get the
+ * variant appended. Names the SnP header defines as macros are left alone. */
+
+#if !defined(KeccakTimesN_variant) || !defined(KeccakTimesN_parallelism)
+#error "Define KeccakTimesN_variant and KeccakTimesN_parallelism first"
+#endif
+
+#define KeccakTimesN_Rename(name) KeccakTimesN_Paste(name, KeccakTimesN_variant)
+#define KeccakTimesN_Paste(name, variant) KeccakTimesN_Paste2(name, variant)
+#define KeccakTimesN_Paste2(name, variant) name##_##variant
+
+#if KeccakTimesN_parallelism == 4
+#ifndef KeccakP1600times4_StaticInitialize
+#define KeccakP1600times4_StaticInitialize KeccakTimesN_Rename(KeccakP1600times4_StaticInitialize)
+#endif
+#ifndef KeccakP1600times4_InitializeAll
+#define KeccakP1600times4_InitializeAll KeccakTimesN_Rename(KeccakP1600times4_InitializeAll)
+#endif
+#ifndef KeccakP1600times4_AddByte
+#define KeccakP1600times4_AddByte KeccakTimesN_Rename(KeccakP1600times4_AddByte)
+#endif
+#ifndef KeccakP1600times4_AddBytes
+#define KeccakP1600times4_AddBytes KeccakTimesN_Rename(KeccakP1600times4_AddBytes)
+#endif
+#ifndef KeccakP1600times4_AddLanesAll
+#define KeccakP1600times4_AddLanesAll KeccakTimesN_Rename(KeccakP1600times4_AddLanesAll)
+#endif
+#ifndef KeccakP1600times4_OverwriteBytes
+#define KeccakP1600times4_OverwriteBytes KeccakTimesN_Rename(KeccakP1600times4_OverwriteBytes)
+#endif
+#ifndef KeccakP1600times4_OverwriteLanesAll
+#define KeccakP1600times4_OverwriteLanesAll KeccakTimesN_Rename(KeccakP1600times4_OverwriteLanesAll)
+#endif
+#ifndef KeccakP1600times4_OverwriteWithZeroes
+#define KeccakP1600times4_OverwriteWithZeroes KeccakTimesN_Rename(KeccakP1600times4_OverwriteWithZeroes)
+#endif
+#ifndef KeccakP1600times4_PermuteAll_4rounds
+#define KeccakP1600times4_PermuteAll_4rounds KeccakTimesN_Rename(KeccakP1600times4_PermuteAll_4rounds)
+#endif
+#ifndef KeccakP1600times4_PermuteAll_6rounds
+#define KeccakP1600times4_PermuteAll_6rounds KeccakTimesN_Rename(KeccakP1600times4_PermuteAll_6rounds)
+#endif
+#ifndef KeccakP1600times4_PermuteAll_12rounds
+#define KeccakP1600times4_PermuteAll_12rounds KeccakTimesN_Rename(KeccakP1600times4_PermuteAll_12rounds)
+#endif
+#ifndef KeccakP1600times4_PermuteAll_24rounds
+#define KeccakP1600times4_PermuteAll_24rounds KeccakTimesN_Rename(KeccakP1600times4_PermuteAll_24rounds)
+#endif
+#ifndef KeccakP1600times4_ExtractBytes
+#define KeccakP1600times4_ExtractBytes KeccakTimesN_Rename(KeccakP1600times4_ExtractBytes)
+#endif
+#ifndef KeccakP1600times4_ExtractLanesAll
+#define KeccakP1600times4_ExtractLanesAll KeccakTimesN_Rename(KeccakP1600times4_ExtractLanesAll)
+#endif
+#ifndef KeccakP1600times4_ExtractAndAddBytes
+#define KeccakP1600times4_ExtractAndAddBytes KeccakTimesN_Rename(KeccakP1600times4_ExtractAndAddBytes)
+#endif
+#ifndef KeccakP1600times4_ExtractAndAddLanesAll
+#define KeccakP1600times4_ExtractAndAddLanesAll KeccakTimesN_Rename(KeccakP1600times4_ExtractAndAddLanesAll)
+#endif
+#ifndef KeccakP1600times4_12rounds_FastLoop_Absorb
+#define KeccakP1600times4_12rounds_FastLoop_Absorb KeccakTimesN_Rename(KeccakP1600times4_12rounds_FastLoop_Absorb)
+#endif
+#ifndef KeccakP1600times4_KravatteCompress
+#define KeccakP1600times4_KravatteCompress KeccakTimesN_Rename(KeccakP1600times4_KravatteCompress)
+#endif
+#ifndef KeccakP1600times4_KravatteExpand
+#define KeccakP1600times4_KravatteExpand KeccakTimesN_Rename(KeccakP1600times4_KravatteExpand)
+#endif
+#ifndef KeccakF1600times4_FastLoop_Absorb
+#define KeccakF1600times4_FastLoop_Absorb KeccakTimesN_Rename(KeccakF1600times4_FastLoop_Absorb)
+#endif
+#elif KeccakTimesN_parallelism == 8
+#ifndef KeccakP1600times8_StaticInitialize
+#define KeccakP1600times8_StaticInitialize KeccakTimesN_Rename(KeccakP1600times8_StaticInitialize)
+#endif
+#ifndef KeccakP1600times8_InitializeAll
+#define KeccakP1600times8_InitializeAll KeccakTimesN_Rename(KeccakP1600times8_InitializeAll)
+#endif
+#ifndef KeccakP1600times8_AddByte
+#define KeccakP1600times8_AddByte KeccakTimesN_Rename(KeccakP1600times8_AddByte)
+#endif
+#ifndef KeccakP1600times8_AddBytes
+#define KeccakP1600times8_AddBytes KeccakTimesN_Rename(KeccakP1600times8_AddBytes)
+#endif
+#ifndef KeccakP1600times8_AddLanesAll
+#define KeccakP1600times8_AddLanesAll KeccakTimesN_Rename(KeccakP1600times8_AddLanesAll)
+#endif
+#ifndef KeccakP1600times8_OverwriteBytes
+#define KeccakP1600times8_OverwriteBytes KeccakTimesN_Rename(KeccakP1600times8_OverwriteBytes)
+#endif
+#ifndef KeccakP1600times8_OverwriteLanesAll
+#define KeccakP1600times8_OverwriteLanesAll KeccakTimesN_Rename(KeccakP1600times8_OverwriteLanesAll)
+#endif
+#ifndef KeccakP1600times8_OverwriteWithZeroes
+#define KeccakP1600times8_OverwriteWithZeroes KeccakTimesN_Rename(KeccakP1600times8_OverwriteWithZeroes)
+#endif
+#ifndef KeccakP1600times8_PermuteAll_4rounds
+#define KeccakP1600times8_PermuteAll_4rounds KeccakTimesN_Rename(KeccakP1600times8_PermuteAll_4rounds)
+#endif
+#ifndef KeccakP1600times8_PermuteAll_6rounds
+#define KeccakP1600times8_PermuteAll_6rounds KeccakTimesN_Rename(KeccakP1600times8_PermuteAll_6rounds)
+#endif
+#ifndef KeccakP1600times8_PermuteAll_12rounds
+#define KeccakP1600times8_PermuteAll_12rounds KeccakTimesN_Rename(KeccakP1600times8_PermuteAll_12rounds)
+#endif
+#ifndef KeccakP1600times8_PermuteAll_24rounds
+#define KeccakP1600times8_PermuteAll_24rounds KeccakTimesN_Rename(KeccakP1600times8_PermuteAll_24rounds)
+#endif
+#ifndef KeccakP1600times8_ExtractBytes
+#define KeccakP1600times8_ExtractBytes KeccakTimesN_Rename(KeccakP1600times8_ExtractBytes)
+#endif
+#ifndef KeccakP1600times8_ExtractLanesAll
+#define KeccakP1600times8_ExtractLanesAll KeccakTimesN_Rename(KeccakP1600times8_ExtractLanesAll)
+#endif
+#ifndef KeccakP1600times8_ExtractAndAddBytes
+#define KeccakP1600times8_ExtractAndAddBytes KeccakTimesN_Rename(KeccakP1600times8_ExtractAndAddBytes)
+#endif
+#ifndef KeccakP1600times8_ExtractAndAddLanesAll
+#define KeccakP1600times8_ExtractAndAddLanesAll KeccakTimesN_Rename(KeccakP1600times8_ExtractAndAddLanesAll)
+#endif
+#ifndef KeccakP1600times8_12rounds_FastLoop_Absorb
+#define KeccakP1600times8_12rounds_FastLoop_Absorb KeccakTimesN_Rename(KeccakP1600times8_12rounds_FastLoop_Absorb)
+#endif
+#ifndef KeccakP1600times8_KravatteCompress
+#define KeccakP1600times8_KravatteCompress KeccakTimesN_Rename(KeccakP1600times8_KravatteCompress)
+#endif
+#ifndef KeccakP1600times8_KravatteExpand
+#define KeccakP1600times8_KravatteExpand KeccakTimesN_Rename(KeccakP1600times8_KravatteExpand)
+#endif
+#ifndef KeccakF1600times8_FastLoop_Absorb
+#define KeccakF1600times8_FastLoop_Absorb KeccakTimesN_Rename(KeccakF1600times8_FastLoop_Absorb)
+#endif
+#else
+#error "Unsupported parallelism"
+#endif
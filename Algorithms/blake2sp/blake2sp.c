@@ -2,6 +2,23 @@
 // Based on public domain 7zip implementation by Igor Pavlov and Samuel Neves
 #include "blake2sp.h"
 
+#include <cpufeatures.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BLAKE2SP_X86
+#include <immintrin.h>
+#endif
+
+/* The kernels are compiled for instructions the flavor may not have, so they
+   carry a target attribute. */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BLAKE2SP_TARGET_SSE41
+#define BLAKE2SP_TARGET_AVX2
+#else
+#define BLAKE2SP_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define BLAKE2SP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 #ifdef LITTLE_ENDIAN_UNALIGNED
 
 #define GetUi32(p) (*(const uint32_t *)(const void *)(p))
@@ -144,6 +161,242 @@ static void Blake2s_Compress(CBlake2s *p)
 }
 
 
+/* ---------- SIMD kernels ---------- */
+
+/* The leaves of BLAKE2sp only differ in their input, so each SIMD lane
+   compresses one leaf, with a vector per word of the state. The words of the
+   message blocks are transposed into the same layout */
+
+#ifdef BLAKE2SP_X86
+
+#define BLAKE2SP_ROUNDS(V, ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+  { \
+    unsigned r; \
+    for (r = 0; r < BLAKE2S_NUM_ROUNDS; r++) \
+    { \
+      const uint8_t *sigma = k_Blake2s_Sigma[r]; \
+      BLAKE2SP_R(V, ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    } \
+  }
+
+#define BLAKE2SP_G(i, a, b, c, d, ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    a = ADD(ADD(a, b), m[sigma[2*i+0]]);  d = ROT16(XOR(d, a));  c = ADD(c, d);  b = ROT12(XOR(b, c)); \
+    a = ADD(ADD(a, b), m[sigma[2*i+1]]);  d = ROT8(XOR(d, a));   c = ADD(c, d);  b = ROT7(XOR(b, c));
+
+#define BLAKE2SP_R(v, ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(0, v[ 0], v[ 4], v[ 8], v[12], ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(1, v[ 1], v[ 5], v[ 9], v[13], ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(2, v[ 2], v[ 6], v[10], v[14], ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(3, v[ 3], v[ 7], v[11], v[15], ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(4, v[ 0], v[ 5], v[10], v[15], ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(5, v[ 1], v[ 6], v[11], v[12], ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(6, v[ 2], v[ 7], v[ 8], v[13], ADD, XOR, ROT16, ROT12, ROT8, ROT7) \
+    BLAKE2SP_G(7, v[ 3], v[ 4], v[ 9], v[14], ADD, XOR, ROT16, ROT12, ROT8, ROT7)
+
+#define ADD4(a, b) _mm_add_epi32((a), (b))
+#define XOR4(a, b) _mm_xor_si128((a), (b))
+#define ROTR4(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+#define ROT16_4(x) _mm_shuffle_epi8((x), rot16)
+#define ROT12_4(x) ROTR4((x), 12)
+#define ROT8_4(x) _mm_shuffle_epi8((x), rot8)
+#define ROT7_4(x) ROTR4((x), 7)
+
+/* Four leaves at a time, S and data point at the first of them */
+BLAKE2SP_TARGET_SSE41
+static void Blake2sp_Blocks4_SSE41(CBlake2s *S, const uint8_t *data, size_t count)
+{
+  const __m128i rot16 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+  const __m128i rot8 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+  const __m128i block_size = _mm_set1_epi32(BLAKE2S_BLOCK_SIZE);
+  const __m128i below_block_size = _mm_set1_epi32(BLAKE2S_BLOCK_SIZE - 1);
+  __m128i h[8], t0, t1;
+  unsigned i;
+
+  for (i = 0; i < 8; i++)
+    h[i] = _mm_setr_epi32((int)S[0].h[i], (int)S[1].h[i], (int)S[2].h[i], (int)S[3].h[i]);
+  t0 = _mm_setr_epi32((int)S[0].t[0], (int)S[1].t[0], (int)S[2].t[0], (int)S[3].t[0]);
+  t1 = _mm_setr_epi32((int)S[0].t[1], (int)S[1].t[1], (int)S[2].t[1], (int)S[3].t[1]);
+
+  for (; count != 0; count--, data += BLAKE2S_BLOCK_SIZE * BLAKE2SP_PARALLEL_DEGREE)
+  {
+    __m128i m[16];
+    __m128i v[16];
+
+    for (i = 0; i < 16; i += 4)
+    {
+      const __m128i r0 = _mm_loadu_si128((const __m128i *)(data + 0 * BLAKE2S_BLOCK_SIZE + i * 4));
+      const __m128i r1 = _mm_loadu_si128((const __m128i *)(data + 1 * BLAKE2S_BLOCK_SIZE + i * 4));
+      const __m128i r2 = _mm_loadu_si128((const __m128i *)(data + 2 * BLAKE2S_BLOCK_SIZE + i * 4));
+      const __m128i r3 = _mm_loadu_si128((const __m128i *)(data + 3 * BLAKE2S_BLOCK_SIZE + i * 4));
+      const __m128i t01lo = _mm_unpacklo_epi32(r0, r1);
+      const __m128i t01hi = _mm_unpackhi_epi32(r0, r1);
+      const __m128i t23lo = _mm_unpacklo_epi32(r2, r3);
+      const __m128i t23hi = _mm_unpackhi_epi32(r2, r3);
+      m[i + 0] = _mm_unpacklo_epi64(t01lo, t23lo);
+      m[i + 1] = _mm_unpackhi_epi64(t01lo, t23lo);
+      m[i + 2] = _mm_unpacklo_epi64(t01hi, t23hi);
+      m[i + 3] = _mm_unpackhi_epi64(t01hi, t23hi);
+    }
+
+    /* The counter is 64 bits, carry where the low word wrapped */
+    t0 = _mm_add_epi32(t0, block_size);
+    t1 = _mm_sub_epi32(t1, _mm_cmpeq_epi32(_mm_min_epu32(t0, below_block_size), t0));
+
+    for (i = 0; i < 8; i++)
+      v[i] = h[i];
+    v[8] = _mm_set1_epi32((int)k_Blake2s_IV[0]);
+    v[9] = _mm_set1_epi32((int)k_Blake2s_IV[1]);
+    v[10] = _mm_set1_epi32((int)k_Blake2s_IV[2]);
+    v[11] = _mm_set1_epi32((int)k_Blake2s_IV[3]);
+    v[12] = _mm_xor_si128(t0, _mm_set1_epi32((int)k_Blake2s_IV[4]));
+    v[13] = _mm_xor_si128(t1, _mm_set1_epi32((int)k_Blake2s_IV[5]));
+    v[14] = _mm_set1_epi32((int)k_Blake2s_IV[6]);
+    v[15] = _mm_set1_epi32((int)k_Blake2s_IV[7]);
+
+    BLAKE2SP_ROUNDS(v, ADD4, XOR4, ROT16_4, ROT12_4, ROT8_4, ROT7_4)
+
+    for (i = 0; i < 8; i++)
+      h[i] = _mm_xor_si128(h[i], _mm_xor_si128(v[i], v[i + 8]));
+  }
+
+  for (i = 0; i < 8; i++)
+  {
+    S[0].h[i] = (uint32_t)_mm_extract_epi32(h[i], 0);
+    S[1].h[i] = (uint32_t)_mm_extract_epi32(h[i], 1);
+    S[2].h[i] = (uint32_t)_mm_extract_epi32(h[i], 2);
+    S[3].h[i] = (uint32_t)_mm_extract_epi32(h[i], 3);
+  }
+  S[0].t[0] = (uint32_t)_mm_extract_epi32(t0, 0);
+  S[1].t[0] = (uint32_t)_mm_extract_epi32(t0, 1);
+  S[2].t[0] = (uint32_t)_mm_extract_epi32(t0, 2);
+  S[3].t[0] = (uint32_t)_mm_extract_epi32(t0, 3);
+  S[0].t[1] = (uint32_t)_mm_extract_epi32(t1, 0);
+  S[1].t[1] = (uint32_t)_mm_extract_epi32(t1, 1);
+  S[2].t[1] = (uint32_t)_mm_extract_epi32(t1, 2);
+  S[3].t[1] = (uint32_t)_mm_extract_epi32(t1, 3);
+}
+
+BLAKE2SP_TARGET_SSE41
+static void Blake2sp_Blocks_SSE41(CBlake2s *S, const uint8_t *data, size_t count)
+{
+  Blake2sp_Blocks4_SSE41(S, data, count);
+  Blake2sp_Blocks4_SSE41(S + 4, data + 4 * BLAKE2S_BLOCK_SIZE, count);
+}
+
+#define ADD8(a, b) _mm256_add_epi32((a), (b))
+#define XOR8(a, b) _mm256_xor_si256((a), (b))
+#define ROTR8(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define ROT16_8(x) _mm256_shuffle_epi8((x), rot16)
+#define ROT12_8(x) ROTR8((x), 12)
+#define ROT8_8(x) _mm256_shuffle_epi8((x), rot8)
+#define ROT7_8(x) ROTR8((x), 7)
+
+BLAKE2SP_TARGET_AVX2
+static void Blake2sp_Blocks_AVX2(CBlake2s *S, const uint8_t *data, size_t count)
+{
+  const __m256i rot16 = _mm256_setr_epi8(
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+  const __m256i rot8 = _mm256_setr_epi8(
+    1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+    1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+  const __m256i block_size = _mm256_set1_epi32(BLAKE2S_BLOCK_SIZE);
+  const __m256i below_block_size = _mm256_set1_epi32(BLAKE2S_BLOCK_SIZE - 1);
+  uint32_t lanes[8];
+  __m256i h[8], t0, t1;
+  unsigned i, j;
+
+  for (i = 0; i < 8; i++)
+  {
+    for (j = 0; j < 8; j++)
+      lanes[j] = S[j].h[i];
+    h[i] = _mm256_loadu_si256((const __m256i *)lanes);
+  }
+  for (j = 0; j < 8; j++)
+    lanes[j] = S[j].t[0];
+  t0 = _mm256_loadu_si256((const __m256i *)lanes);
+  for (j = 0; j < 8; j++)
+    lanes[j] = S[j].t[1];
+  t1 = _mm256_loadu_si256((const __m256i *)lanes);
+
+  for (; count != 0; count--, data += BLAKE2S_BLOCK_SIZE * BLAKE2SP_PARALLEL_DEGREE)
+  {
+    __m256i m[16];
+    __m256i v[16];
+
+    for (i = 0; i < 16; i += 8)
+    {
+      __m256i r[8], t[8], u[8];
+      for (j = 0; j < 8; j++)
+        r[j] = _mm256_loadu_si256((const __m256i *)(data + j * BLAKE2S_BLOCK_SIZE + i * 4));
+      for (j = 0; j < 8; j += 2)
+      {
+        t[j + 0] = _mm256_unpacklo_epi32(r[j], r[j + 1]);
+        t[j + 1] = _mm256_unpackhi_epi32(r[j], r[j + 1]);
+      }
+      for (j = 0; j < 8; j += 4)
+      {
+        u[j + 0] = _mm256_unpacklo_epi64(t[j + 0], t[j + 2]);
+        u[j + 1] = _mm256_unpackhi_epi64(t[j + 0], t[j + 2]);
+        u[j + 2] = _mm256_unpacklo_epi64(t[j + 1], t[j + 3]);
+        u[j + 3] = _mm256_unpackhi_epi64(t[j + 1], t[j + 3]);
+      }
+      for (j = 0; j < 4; j++)
+      {
+        m[i + j + 0] = _mm256_permute2x128_si256(u[j], u[j + 4], 0x20);
+        m[i + j + 4] = _mm256_permute2x128_si256(u[j], u[j + 4], 0x31);
+      }
+    }
+
+    /* The counter is 64 bits, carry where the low word wrapped */
+    t0 = _mm256_add_epi32(t0, block_size);
+    t1 = _mm256_sub_epi32(t1, _mm256_cmpeq_epi32(_mm256_min_epu32(t0, below_block_size), t0));
+
+    for (i = 0; i < 8; i++)
+      v[i] = h[i];
+    v[8] = _mm256_set1_epi32((int)k_Blake2s_IV[0]);
+    v[9] = _mm256_set1_epi32((int)k_Blake2s_IV[1]);
+    v[10] = _mm256_set1_epi32((int)k_Blake2s_IV[2]);
+    v[11] = _mm256_set1_epi32((int)k_Blake2s_IV[3]);
+    v[12] = _mm256_xor_si256(t0, _mm256_set1_epi32((int)k_Blake2s_IV[4]));
+    v[13] = _mm256_xor_si256(t1, _mm256_set1_epi32((int)k_Blake2s_IV[5]));
+    v[14] = _mm256_set1_epi32((int)k_Blake2s_IV[6]);
+    v[15] = _mm256_set1_epi32((int)k_Blake2s_IV[7]);
+
+    BLAKE2SP_ROUNDS(v, ADD8, XOR8, ROT16_8, ROT12_8, ROT8_8, ROT7_8)
+
+    for (i = 0; i < 8; i++)
+      h[i] = _mm256_xor_si256(h[i], _mm256_xor_si256(v[i], v[i + 8]));
+  }
+
+  for (i = 0; i < 8; i++)
+  {
+    _mm256_storeu_si256((__m256i *)lanes, h[i]);
+    for (j = 0; j < 8; j++)
+      S[j].h[i] = lanes[j];
+  }
+  _mm256_storeu_si256((__m256i *)lanes, t0);
+  for (j = 0; j < 8; j++)
+    S[j].t[0] = lanes[j];
+  _mm256_storeu_si256((__m256i *)lanes, t1);
+  for (j = 0; j < 8; j++)
+    S[j].t[1] = lanes[j];
+}
+
+#endif
+
+static Blake2sp_BlocksFn *Blake2sp_Blocks(void)
+{
+#ifdef BLAKE2SP_X86
+  if (cpu_has(CPU_FEATURE_AVX2))
+    return Blake2sp_Blocks_AVX2;
+  if (cpu_has(CPU_FEATURE_SSE41))
+    return Blake2sp_Blocks_SSE41;
+#endif
+  return NULL;
+}
+
+
 #define Blake2s_Increment_Counter(S, inc) \
   { p->t[0] += (inc); p->t[1] += (p->t[0] < (inc)); }
 
@@ -234,6 +487,7 @@ void Blake2sp_Init(CBlake2sp *p)
   unsigned i;
 
   p->bufPos = 0;
+  p->blocks = Blake2sp_Blocks();
 
   for (i = 0; i < BLAKE2SP_PARALLEL_DEGREE; i++)
     Blake2sp_Init_Spec(&p->S[i], i, 0);
@@ -242,9 +496,40 @@ void Blake2sp_Init(CBlake2sp *p)
 }
 
 
+/* A leaf only compresses a block once more of its input shows up, as the
+   last one is compressed differently. Past a run of one block per leaf, all
+   leaves have more input once this much follows */
+#define BLAKE2SP_RUN_SIZE (BLAKE2S_BLOCK_SIZE * BLAKE2SP_PARALLEL_DEGREE)
+#define BLAKE2SP_RUN_FOLLOWED_SIZE (BLAKE2SP_RUN_SIZE - BLAKE2S_BLOCK_SIZE + 1)
+
 void Blake2sp_Update(CBlake2sp *p, const uint8_t *data, size_t size)
 {
   unsigned pos = p->bufPos;
+
+  if (p->blocks && pos == 0 && size >= BLAKE2SP_RUN_FOLLOWED_SIZE)
+  {
+    /* Between runs the leaves either all hold a full block, or are empty */
+    if (p->S[0].bufPos == BLAKE2S_BLOCK_SIZE)
+    {
+      uint8_t run[BLAKE2SP_RUN_SIZE];
+      unsigned i;
+      for (i = 0; i < BLAKE2SP_PARALLEL_DEGREE; i++)
+      {
+        memcpy(run + i * BLAKE2S_BLOCK_SIZE, p->S[i].buf, BLAKE2S_BLOCK_SIZE);
+        p->S[i].bufPos = 0;
+      }
+      p->blocks(p->S, run, 1);
+    }
+
+    if (size >= BLAKE2SP_RUN_SIZE + BLAKE2SP_RUN_FOLLOWED_SIZE)
+    {
+      const size_t count = (size - BLAKE2SP_RUN_FOLLOWED_SIZE) / BLAKE2SP_RUN_SIZE;
+      p->blocks(p->S, data, count);
+      data += count * BLAKE2SP_RUN_SIZE;
+      size -= count * BLAKE2SP_RUN_SIZE;
+    }
+  }
+
   while (size != 0)
   {
     unsigned index = pos / BLAKE2S_BLOCK_SIZE;
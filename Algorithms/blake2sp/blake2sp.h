@@ -36,10 +36,15 @@ typedef struct
   uint32_t dummy[2]; /* for sizeof(CBlake2s) alignment */
 } CBlake2s;
 
+/* Compresses count runs of one block per leaf, that are not the last blocks
+   of their leaves. The leaves' blocks of a run follow each other in data */
+typedef void Blake2sp_BlocksFn(CBlake2s *S, const uint8_t *data, size_t count);
+
 typedef struct
 {
   CBlake2s S[BLAKE2SP_PARALLEL_DEGREE];
   unsigned bufPos;
+  Blake2sp_BlocksFn *blocks; /* SIMD kernel hashing all leaves at once, if the CPU has one */
 } CBlake2sp;
 
 void Blake2sp_Init(CBlake2sp *p);
@@ -0,0 +1,184 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "cpufeatures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPUFEATURES_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define CPUFEATURES_ARM64
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/auxv.h>
+#endif
+#endif
+
+// Set once detection ran, so that a CPU with no features isn't probed again
+#define CPU_FEATURES_DETECTED (1u << 31)
+
+static volatile uint32_t s_features;
+
+#ifdef CPUFEATURES_X86
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+  __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv0(void)
+{
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (uint64_t)edx << 32 | eax;
+#endif
+}
+
+static uint32_t detect(void)
+{
+  uint32_t features = 0;
+  uint32_t regs[4];
+
+  cpuid(0, 0, regs);
+  const uint32_t max_leaf = regs[0];
+
+  cpuid(1, 0, regs);
+  const uint32_t ecx1 = regs[2];
+  if (ecx1 & (1u << 9))
+    features |= CPU_FEATURE_SSSE3;
+  if (ecx1 & (1u << 19))
+    features |= CPU_FEATURE_SSE41;
+  if (ecx1 & (1u << 1))
+    features |= CPU_FEATURE_PCLMUL;
+
+  // XMM and YMM state, then opmask and both halves of ZMM state
+  int os_avx = 0;
+  int os_avx512 = 0;
+  if (ecx1 & (1u << 27))
+  {
+    const uint64_t xcr0 = xgetbv0();
+    os_avx = (xcr0 & 0x06) == 0x06;
+    os_avx512 = os_avx && (xcr0 & 0xE0) == 0xE0;
+  }
+
+  if (os_avx && (ecx1 & (1u << 28)))
+  {
+    features |= CPU_FEATURE_AVX;
+    if (ecx1 & (1u << 12))
+      features |= CPU_FEATURE_FMA;
+  }
+
+  if (max_leaf >= 7)
+  {
+    cpuid(7, 0, regs);
+    const uint32_t max_subleaf = regs[0];
+    const uint32_t ebx7 = regs[1];
+    const uint32_t ecx7 = regs[2];
+
+    if (ebx7 & (1u << 3))
+      features |= CPU_FEATURE_BMI1;
+    if (ebx7 & (1u << 8))
+      features |= CPU_FEATURE_BMI2;
+    if (ebx7 & (1u << 29))
+      features |= CPU_FEATURE_SHA;
+
+    if (features & CPU_FEATURE_AVX)
+    {
+      if (ebx7 & (1u << 5))
+        features |= CPU_FEATURE_AVX2;
+      if (ecx7 & (1u << 9))
+        features |= CPU_FEATURE_VAES;
+      if (ecx7 & (1u << 10))
+        features |= CPU_FEATURE_VPCLMUL;
+      if (max_subleaf >= 1)
+      {
+        cpuid(7, 1, regs);
+        if (regs[0] & (1u << 0))
+          features |= CPU_FEATURE_SHA512;
+      }
+    }
+
+    if (os_avx512 && (ebx7 & (1u << 16)))
+    {
+      features |= CPU_FEATURE_AVX512F;
+      if (ebx7 & (1u << 17))
+        features |= CPU_FEATURE_AVX512DQ;
+      if (ebx7 & (1u << 30))
+        features |= CPU_FEATURE_AVX512BW;
+      if (ebx7 & (1u << 31))
+        features |= CPU_FEATURE_AVX512VL;
+    }
+  }
+
+  return features;
+}
+
+#elif defined(CPUFEATURES_ARM64)
+
+static uint32_t detect(void)
+{
+  uint32_t features = 0;
+#if defined(_WIN32)
+  // Windows only reports the crypto extensions as a whole
+  if (IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE))
+    features |= CPU_FEATURE_ARM_SHA1 | CPU_FEATURE_ARM_SHA2 | CPU_FEATURE_ARM_PMULL;
+#else
+  const unsigned long hwcap = getauxval(AT_HWCAP);
+  if (hwcap & (1ul << 4))
+    features |= CPU_FEATURE_ARM_PMULL;
+  if (hwcap & (1ul << 5))
+    features |= CPU_FEATURE_ARM_SHA1;
+  if (hwcap & (1ul << 6))
+    features |= CPU_FEATURE_ARM_SHA2;
+  if (hwcap & (1ul << 17))
+    features |= CPU_FEATURE_ARM_SHA3;
+  if (hwcap & (1ul << 21))
+    features |= CPU_FEATURE_ARM_SHA512;
+#endif
+  return features;
+}
+
+#else
+
+static uint32_t detect(void)
+{
+  return 0;
+}
+
+#endif
+
+uint32_t cpu_features(void)
+{
+  uint32_t features = s_features;
+  if (!(features & CPU_FEATURES_DETECTED))
+  {
+    // Racing threads all come up with the same answer
+    features = detect() | CPU_FEATURES_DETECTED;
+    s_features = features;
+  }
+  return features;
+}
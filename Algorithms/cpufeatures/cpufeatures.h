@@ -0,0 +1,67 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#ifndef EXTERN_C_START
+#ifdef __cplusplus
+#define EXTERN_C_START extern "C" {
+#define EXTERN_C_END }
+#else
+#define EXTERN_C_START
+#define EXTERN_C_END
+#endif
+#endif
+
+EXTERN_C_START
+
+#include <stdint.h>
+
+// Instruction set extensions that kernels may pick at runtime on top of what
+// the flavor was compiled for. A feature is only reported if the OS also saves
+// the registers it needs.
+
+#define CPU_FEATURE_SSSE3       (1u << 0)
+#define CPU_FEATURE_SSE41       (1u << 1)
+#define CPU_FEATURE_AVX         (1u << 2)
+#define CPU_FEATURE_AVX2        (1u << 3)
+#define CPU_FEATURE_BMI2        (1u << 4)
+#define CPU_FEATURE_AVX512F     (1u << 5)
+#define CPU_FEATURE_AVX512BW    (1u << 6)
+#define CPU_FEATURE_AVX512VL    (1u << 7)
+#define CPU_FEATURE_SHA         (1u << 8)
+#define CPU_FEATURE_SHA512      (1u << 9)
+#define CPU_FEATURE_PCLMUL      (1u << 10)
+#define CPU_FEATURE_VPCLMUL     (1u << 11)
+#define CPU_FEATURE_VAES        (1u << 12)
+#define CPU_FEATURE_FMA         (1u << 13)
+#define CPU_FEATURE_BMI1        (1u << 14)
+#define CPU_FEATURE_AVX512DQ    (1u << 15)
+
+#define CPU_FEATURE_ARM_SHA1    (1u << 16)
+#define CPU_FEATURE_ARM_SHA2    (1u << 17)
+#define CPU_FEATURE_ARM_SHA512  (1u << 18)
+#define CPU_FEATURE_ARM_SHA3    (1u << 19)
+#define CPU_FEATURE_ARM_PMULL   (1u << 20)
+
+// Detected once, then cached.
+uint32_t cpu_features(void);
+
+static inline int cpu_has(uint32_t features)
+{
+  return (cpu_features() & features) == features;
+}
+
+EXTERN_C_END
@@ -1,5 +1,6 @@
 // public domain, by duk
 #include "crc64.h"
+#include <algorithm>
 #include <array>
 #include <cstdint>
 
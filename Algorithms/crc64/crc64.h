@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 
 uint64_t crc64(uint64_t crc, const void* buf, size_t len);
@@ -0,0 +1,333 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "crcfold.h"
+
+#include <array>
+
+#include <cpufeatures.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRCFOLD_X86
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define CRCFOLD_ARM64
+#include <arm_neon.h>
+#endif
+
+// The kernels are compiled for instructions the flavor may not have, so they
+// and everything inlined into them carry a target attribute.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CRCFOLD_INLINE __forceinline
+#define CRCFOLD_TARGET_PCLMUL
+#define CRCFOLD_TARGET_VPCLMUL
+#define CRCFOLD_TARGET_ARM64
+#else
+#define CRCFOLD_INLINE inline __attribute__((always_inline))
+#define CRCFOLD_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#define CRCFOLD_TARGET_VPCLMUL __attribute__((target("pclmul,sse4.1,avx512f,vpclmulqdq")))
+#if defined(__clang__)
+#define CRCFOLD_TARGET_ARM64 __attribute__((target("aes")))
+#else
+#define CRCFOLD_TARGET_ARM64 __attribute__((target("+aes")))
+#endif
+#endif
+
+namespace {
+
+// Arithmetic modulo the polynomial of a reflected CRC, in the layout of the
+// CRC register: bit Width - 1 - d holds the coefficient of x^d.
+template <typename T, T Poly>
+struct Crc {
+  using Value = T;
+
+  static constexpr unsigned k_width = sizeof(T) * 8;
+  static constexpr T k_one = T(1) << (k_width - 1);
+
+  static constexpr T mul(T a, T b) {
+    T p = 0;
+    for (T m = k_one; m; m >>= 1) {
+      if (a & m)
+        p ^= b;
+      b = (b & 1) ? (b >> 1) ^ Poly : b >> 1;
+    }
+    return p;
+  }
+
+  // x^(2^k) for every bit of a 64 bit byte count, times the 8 bits of a byte
+  static constexpr auto k_x2n = [] {
+    std::array<T, 64 + 3> out{};
+    out[0] = k_one >> 1;
+    for (size_t k = 1; k < out.size(); ++k)
+      out[k] = mul(out[k - 1], out[k - 1]);
+    return out;
+  }();
+
+  static constexpr T xpow(uint64_t n, size_t k = 0) {
+    T p = k_one;
+    for (; n; n >>= 1, ++k)
+      if (n & 1)
+        p = mul(k_x2n[k], p);
+    return p;
+  }
+
+  static constexpr auto k_table = [] {
+    std::array<T, 256> out{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      T crc = i;
+      for (uint32_t j = 0; j < 8; ++j)
+        crc = (crc >> 1) ^ ((crc & 1) * Poly);
+      out[i] = crc;
+    }
+    return out;
+  }();
+
+  // Register in, register out, without the inversions
+  static T bytes(T crc, const uint8_t* p, size_t n) {
+    for (; n; --n)
+      crc = k_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+  }
+
+  static T combine(T crc_a, T crc_b, uint64_t size_b) {
+    return mul(xpow(size_b, 3), crc_a) ^ crc_b;
+  }
+
+  // Folding a 128 bit lane forward by `bits` multiplies its low half (the
+  // higher degrees) by x^(bits + 64) and its high half by x^bits. The product
+  // of two reflected 64 bit values comes out one bit short, which the
+  // constants make up for.
+  static constexpr std::array<uint64_t, 2> fold(uint64_t bits) {
+    return {
+      (uint64_t)xpow(bits + 63) << (64 - k_width),
+      (uint64_t)xpow(bits - 1) << (64 - k_width),
+    };
+  }
+};
+
+using Crc32 = Crc<uint32_t, 0xEDB88320>;
+using Crc64 = Crc<uint64_t, 0xC96C5795D7870F42>;
+
+// All kernels fold the message into a 128 bit remainder that has the same CRC
+// as everything it replaced, then run the table over it and whatever is left.
+
+#ifdef CRCFOLD_X86
+
+template <typename C>
+struct PclmulX86 {
+  using T = typename C::Value;
+
+  alignas(16) static constexpr auto k_fold512 = C::fold(512);
+  alignas(16) static constexpr auto k_fold128 = C::fold(128);
+
+  CRCFOLD_TARGET_PCLMUL CRCFOLD_INLINE static __m128i fold(__m128i a, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x00), _mm_clmulepi64_si128(a, k, 0x11));
+  }
+
+  CRCFOLD_TARGET_PCLMUL CRCFOLD_INLINE static __m128i load(const uint8_t* p) {
+    return _mm_loadu_si128((const __m128i*)p);
+  }
+
+  CRCFOLD_TARGET_PCLMUL CRCFOLD_INLINE static __m128i reg(T crc) {
+    return _mm_set_epi64x(0, (int64_t)(uint64_t)crc);
+  }
+
+  CRCFOLD_TARGET_PCLMUL CRCFOLD_INLINE static T finish(__m128i x, const uint8_t* p, size_t n) {
+    const auto k128 = _mm_load_si128((const __m128i*)k_fold128.data());
+    for (; n >= 16; p += 16, n -= 16)
+      x = _mm_xor_si128(fold(x, k128), load(p));
+    alignas(16) uint8_t rest[16];
+    _mm_store_si128((__m128i*)rest, x);
+    return C::bytes(C::bytes(0, rest, sizeof(rest)), p, n);
+  }
+
+  CRCFOLD_TARGET_PCLMUL static T raw(T crc, const uint8_t* p, size_t n) {
+    if (n < 64)
+      return C::bytes(crc, p, n);
+
+    __m128i x[4];
+    for (size_t i = 0; i < 4; ++i)
+      x[i] = load(p + i * 16);
+    x[0] = _mm_xor_si128(x[0], reg(crc));
+    p += 64;
+    n -= 64;
+
+    const auto k512 = _mm_load_si128((const __m128i*)k_fold512.data());
+    for (; n >= 64; p += 64, n -= 64)
+      for (size_t i = 0; i < 4; ++i)
+        x[i] = _mm_xor_si128(fold(x[i], k512), load(p + i * 16));
+
+    const auto k128 = _mm_load_si128((const __m128i*)k_fold128.data());
+    for (size_t i = 1; i < 4; ++i)
+      x[i] = _mm_xor_si128(fold(x[i - 1], k128), x[i]);
+
+    return finish(x[3], p, n);
+  }
+
+  static T update(T crc, const void* data, size_t size) {
+    return ~raw(~crc, (const uint8_t*)data, size);
+  }
+};
+
+template <typename C>
+struct VpclmulX86 {
+  using T = typename C::Value;
+  using Narrow = PclmulX86<C>;
+
+  alignas(16) static constexpr auto k_fold2048 = C::fold(2048);
+  alignas(16) static constexpr auto k_fold512 = C::fold(512);
+  alignas(16) static constexpr auto k_fold384 = C::fold(384);
+  alignas(16) static constexpr auto k_fold256 = C::fold(256);
+
+  CRCFOLD_TARGET_VPCLMUL CRCFOLD_INLINE static __m512i broadcast(const std::array<uint64_t, 2>& k) {
+    return _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)k.data()));
+  }
+
+  CRCFOLD_TARGET_VPCLMUL CRCFOLD_INLINE static __m512i fold_xor(__m512i a, __m512i k, __m512i b) {
+    return _mm512_ternarylogic_epi64(
+      _mm512_clmulepi64_epi128(a, k, 0x00),
+      _mm512_clmulepi64_epi128(a, k, 0x11),
+      b,
+      0x96
+    );
+  }
+
+  CRCFOLD_TARGET_VPCLMUL static T raw(T crc, const uint8_t* p, size_t n) {
+    if (n < 256)
+      return Narrow::raw(crc, p, n);
+
+    __m512i z[4];
+    for (size_t i = 0; i < 4; ++i)
+      z[i] = _mm512_loadu_si512(p + i * 64);
+    z[0] = _mm512_xor_si512(z[0], _mm512_zextsi128_si512(Narrow::reg(crc)));
+    p += 256;
+    n -= 256;
+
+    const auto k2048 = broadcast(k_fold2048);
+    for (; n >= 256; p += 256, n -= 256)
+      for (size_t i = 0; i < 4; ++i)
+        z[i] = fold_xor(z[i], k2048, _mm512_loadu_si512(p + i * 64));
+
+    const auto k512 = broadcast(k_fold512);
+    for (size_t i = 1; i < 4; ++i)
+      z[i] = fold_xor(z[i - 1], k512, z[i]);
+    for (; n >= 64; p += 64, n -= 64)
+      z[3] = fold_xor(z[3], k512, _mm512_loadu_si512(p));
+
+    // The first three lanes are 384, 256 and 128 bits away from the last one
+    const auto k384 = _mm_load_si128((const __m128i*)k_fold384.data());
+    const auto k256 = _mm_load_si128((const __m128i*)k_fold256.data());
+    const auto k128 = _mm_load_si128((const __m128i*)Narrow::k_fold128.data());
+    auto x = _mm512_extracti32x4_epi32(z[3], 3);
+    x = _mm_xor_si128(x, Narrow::fold(_mm512_extracti32x4_epi32(z[3], 0), k384));
+    x = _mm_xor_si128(x, Narrow::fold(_mm512_extracti32x4_epi32(z[3], 1), k256));
+    x = _mm_xor_si128(x, Narrow::fold(_mm512_extracti32x4_epi32(z[3], 2), k128));
+
+    return Narrow::finish(x, p, n);
+  }
+
+  static T update(T crc, const void* data, size_t size) {
+    return ~raw(~crc, (const uint8_t*)data, size);
+  }
+};
+
+#endif
+
+#ifdef CRCFOLD_ARM64
+
+template <typename C>
+struct PmullArm64 {
+  using T = typename C::Value;
+
+  static constexpr auto k_fold512 = C::fold(512);
+  static constexpr auto k_fold128 = C::fold(128);
+
+  CRCFOLD_TARGET_ARM64 CRCFOLD_INLINE static uint64x2_t fold(uint64x2_t a, const std::array<uint64_t, 2>& k) {
+    const auto lo = vmull_p64((poly64_t)vgetq_lane_u64(a, 0), (poly64_t)k[0]);
+    const auto hi = vmull_p64((poly64_t)vgetq_lane_u64(a, 1), (poly64_t)k[1]);
+    return veorq_u64(vreinterpretq_u64_p128(lo), vreinterpretq_u64_p128(hi));
+  }
+
+  CRCFOLD_TARGET_ARM64 CRCFOLD_INLINE static uint64x2_t load(const uint8_t* p) {
+    return vreinterpretq_u64_u8(vld1q_u8(p));
+  }
+
+  CRCFOLD_TARGET_ARM64 static T raw(T crc, const uint8_t* p, size_t n) {
+    if (n < 64)
+      return C::bytes(crc, p, n);
+
+    uint64x2_t x[4];
+    for (size_t i = 0; i < 4; ++i)
+      x[i] = load(p + i * 16);
+    x[0] = veorq_u64(x[0], vcombine_u64(vcreate_u64((uint64_t)crc), vcreate_u64(0)));
+    p += 64;
+    n -= 64;
+
+    for (; n >= 64; p += 64, n -= 64)
+      for (size_t i = 0; i < 4; ++i)
+        x[i] = veorq_u64(fold(x[i], k_fold512), load(p + i * 16));
+
+    for (size_t i = 1; i < 4; ++i)
+      x[i] = veorq_u64(fold(x[i - 1], k_fold128), x[i]);
+    for (; n >= 16; p += 16, n -= 16)
+      x[3] = veorq_u64(fold(x[3], k_fold128), load(p));
+
+    uint8_t rest[16];
+    vst1q_u8(rest, vreinterpretq_u8_u64(x[3]));
+    return C::bytes(C::bytes(0, rest, sizeof(rest)), p, n);
+  }
+
+  static T update(T crc, const void* data, size_t size) {
+    return ~raw(~crc, (const uint8_t*)data, size);
+  }
+};
+
+#endif
+
+template <typename C>
+auto clmul() -> typename C::Value (*)(typename C::Value, const void*, size_t) {
+#if defined(CRCFOLD_X86)
+  if (cpu_has(CPU_FEATURE_VPCLMUL | CPU_FEATURE_AVX512F))
+    return &VpclmulX86<C>::update;
+  if (cpu_has(CPU_FEATURE_PCLMUL | CPU_FEATURE_SSE41))
+    return &PclmulX86<C>::update;
+#elif defined(CRCFOLD_ARM64)
+  if (cpu_has(CPU_FEATURE_ARM_PMULL))
+    return &PmullArm64<C>::update;
+#endif
+  return nullptr;
+}
+
+} // namespace
+
+namespace crcfold {
+
+Crc32Fn* crc32_clmul() {
+  return clmul<Crc32>();
+}
+
+Crc64Fn* crc64_clmul() {
+  return clmul<Crc64>();
+}
+
+uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t size_b) {
+  return Crc32::combine(crc_a, crc_b, size_b);
+}
+
+uint64_t crc64_combine(uint64_t crc_a, uint64_t crc_b, uint64_t size_b) {
+  return Crc64::combine(crc_a, crc_b, size_b);
+}
+
+}
@@ -0,0 +1,38 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (the zlib one) and CRC-64 (the xz one) folded with carry-less
+// multiplication: PCLMULQDQ, VPCLMULQDQ on 512 bit vectors, or PMULL on
+// ARM64. The functions take and return the same values as crc32_fast and
+// crc64, so the table implementations stay as the fallback.
+
+namespace crcfold {
+
+using Crc32Fn = uint32_t(uint32_t crc, const void* data, size_t size);
+using Crc64Fn = uint64_t(uint64_t crc, const void* data, size_t size);
+
+// These return nullptr if the CPU doesn't have the instructions.
+Crc32Fn* crc32_clmul();
+Crc64Fn* crc64_clmul();
+
+// CRC of A || B from the CRCs of A and B, and the size of B
+uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, uint64_t size_b);
+uint64_t crc64_combine(uint64_t crc_a, uint64_t crc_b, uint64_t size_b);
+
+}
@@ -0,0 +1,88 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "multibuffer_kernels.h"
+
+#include <cpufeatures.h>
+
+namespace {
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+struct VecSse2 {
+  using T = __m128i;
+  static constexpr size_t k_lanes = 4;
+
+  static T load(const uint32_t* p) { return _mm_load_si128((const __m128i*)p); }
+  static void store(uint32_t* p, T v) { _mm_store_si128((__m128i*)p, v); }
+  static T set1(uint32_t v) { return _mm_set1_epi32((int)v); }
+  static T add(T a, T b) { return _mm_add_epi32(a, b); }
+  static T xor_(T a, T b) { return _mm_xor_si128(a, b); }
+  static T or_(T a, T b) { return _mm_or_si128(a, b); }
+  template <int N> static T rotl(T a) { return _mm_or_si128(_mm_slli_epi32(a, N), _mm_srli_epi32(a, 32 - N)); }
+  template <int N> static T shr(T a) { return _mm_srli_epi32(a, N); }
+  static T bswap(T a) {
+#ifdef __SSSE3__
+    return _mm_shuffle_epi8(a, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+#else
+    a = rotl<16>(a);
+    return _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+#endif
+  }
+  static T ch(T x, T y, T z) { return xor_(z, _mm_and_si128(x, xor_(y, z))); }
+  static T maj(T x, T y, T z) { return or_(_mm_and_si128(x, y), _mm_and_si128(z, or_(x, y))); }
+  static T xor3(T x, T y, T z) { return xor_(xor_(x, y), z); }
+  static T ornot_xor(T x, T y, T z) { return xor_(or_(x, xor_(y, _mm_set1_epi32(-1))), z); }
+};
+
+constexpr auto k_baseline_kernels = make_kernels<VecSse2>();
+
+#else
+
+constexpr auto k_baseline_kernels = make_kernels<VecScalar>();
+
+#endif
+
+const mb::Kernels& kernels() {
+#if defined(OHT_RUNTIME_DISPATCH)
+  if (cpu_has(CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512BW))
+    return mb::k_avx512_kernels;
+  if (cpu_has(CPU_FEATURE_AVX2))
+    return mb::k_avx2_kernels;
+#endif
+  return k_baseline_kernels;
+}
+
+}
+
+size_t mb::lanes() {
+  return kernels().lanes;
+}
+
+void mb::md5_many(Stream* streams, size_t count) {
+  kernels().md5_many(streams, count);
+}
+
+void mb::sha1_many(Stream* streams, size_t count) {
+  kernels().sha1_many(streams, count);
+}
+
+void mb::sha256_many(Stream* streams, size_t count) {
+  kernels().sha256_many(streams, count);
+}
+
+void mb::ripemd160_many(Stream* streams, size_t count) {
+  kernels().ripemd160_many(streams, count);
+}
@@ -0,0 +1,45 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Multi-buffer kernels hash several independent messages at once, one message
+// per SIMD lane. They only process whole 64 byte blocks, buffering and
+// padding is left to the caller.
+
+namespace mb {
+
+constexpr size_t k_block_size = 64;
+
+struct Stream {
+  uint32_t* state;
+  const uint8_t* data;
+  size_t blocks;
+};
+
+// Lanes of the widest kernels the CPU can run, picked at runtime. 1 if there
+// are none, the functions below then hash one stream at a time.
+size_t lanes();
+
+// Hash each stream's blocks into its state. Streams can be of any length and
+// in any number, they are scheduled onto lanes as others run out of blocks.
+void md5_many(Stream* streams, size_t count);
+void sha1_many(Stream* streams, size_t count);
+void sha256_many(Stream* streams, size_t count);
+void ripemd160_many(Stream* streams, size_t count);
+
+}
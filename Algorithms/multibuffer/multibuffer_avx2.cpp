@@ -0,0 +1,47 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "multibuffer_kernels.h"
+
+namespace {
+
+struct VecAvx2 {
+  using T = __m256i;
+  static constexpr size_t k_lanes = 8;
+
+  static T load(const uint32_t* p) { return _mm256_load_si256((const __m256i*)p); }
+  static void store(uint32_t* p, T v) { _mm256_store_si256((__m256i*)p, v); }
+  static T set1(uint32_t v) { return _mm256_set1_epi32((int)v); }
+  static T add(T a, T b) { return _mm256_add_epi32(a, b); }
+  static T xor_(T a, T b) { return _mm256_xor_si256(a, b); }
+  static T or_(T a, T b) { return _mm256_or_si256(a, b); }
+  template <int N> static T rotl(T a) { return _mm256_or_si256(_mm256_slli_epi32(a, N), _mm256_srli_epi32(a, 32 - N)); }
+  template <int N> static T shr(T a) { return _mm256_srli_epi32(a, N); }
+  static T bswap(T a) {
+    const auto shuffle = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+    );
+    return _mm256_shuffle_epi8(a, shuffle);
+  }
+  static T ch(T x, T y, T z) { return xor_(z, _mm256_and_si256(x, xor_(y, z))); }
+  static T maj(T x, T y, T z) { return or_(_mm256_and_si256(x, y), _mm256_and_si256(z, or_(x, y))); }
+  static T xor3(T x, T y, T z) { return xor_(xor_(x, y), z); }
+  static T ornot_xor(T x, T y, T z) { return xor_(or_(x, xor_(y, _mm256_set1_epi32(-1))), z); }
+};
+
+}
+
+const mb::Kernels mb::k_avx2_kernels = make_kernels<VecAvx2>();
@@ -0,0 +1,44 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "multibuffer_kernels.h"
+
+namespace {
+
+struct VecAvx512 {
+  using T = __m512i;
+  static constexpr size_t k_lanes = 16;
+
+  static T load(const uint32_t* p) { return _mm512_load_si512(p); }
+  static void store(uint32_t* p, T v) { _mm512_store_si512(p, v); }
+  static T set1(uint32_t v) { return _mm512_set1_epi32((int)v); }
+  static T add(T a, T b) { return _mm512_add_epi32(a, b); }
+  static T xor_(T a, T b) { return _mm512_xor_si512(a, b); }
+  static T or_(T a, T b) { return _mm512_or_si512(a, b); }
+  template <int N> static T rotl(T a) { return _mm512_rol_epi32(a, N); }
+  template <int N> static T shr(T a) { return _mm512_srli_epi32(a, N); }
+  static T bswap(T a) {
+    const auto shuffle = _mm512_broadcast_i32x4(_mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    return _mm512_shuffle_epi8(a, shuffle);
+  }
+  static T ch(T x, T y, T z) { return _mm512_ternarylogic_epi32(x, y, z, 0xCA); }
+  static T maj(T x, T y, T z) { return _mm512_ternarylogic_epi32(x, y, z, 0xE8); }
+  static T xor3(T x, T y, T z) { return _mm512_ternarylogic_epi32(x, y, z, 0x96); }
+  static T ornot_xor(T x, T y, T z) { return _mm512_ternarylogic_epi32(x, y, z, 0x59); }
+};
+
+}
+
+const mb::Kernels mb::k_avx512_kernels = make_kernels<VecAvx512>();
@@ -0,0 +1,445 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+#include "multibuffer.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MB_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MB_INLINE __forceinline
+#else
+#define MB_INLINE inline __attribute__((always_inline))
+#endif
+
+// The kernels are built once per lane width, each in a file compiled for the
+// instructions that width needs. Everything below has internal linkage and
+// leaves the standard library alone, so no code built for a wider instruction
+// set can end up called from another file.
+
+namespace mb {
+
+struct Kernels {
+  size_t lanes;
+  void (*md5_many)(Stream* streams, size_t count);
+  void (*sha1_many)(Stream* streams, size_t count);
+  void (*sha256_many)(Stream* streams, size_t count);
+  void (*ripemd160_many)(Stream* streams, size_t count);
+};
+
+extern const Kernels k_avx2_kernels;
+extern const Kernels k_avx512_kernels;
+
+}
+
+namespace {
+
+// Lane types. All algorithms are written against this interface, so the same
+// code gives both the single stream and the wide kernels.
+
+struct VecScalar {
+  using T = uint32_t;
+  static constexpr size_t k_lanes = 1;
+
+  static T load(const uint32_t* p) { return *p; }
+  static void store(uint32_t* p, T v) { *p = v; }
+  static T set1(uint32_t v) { return v; }
+  static T add(T a, T b) { return a + b; }
+  static T xor_(T a, T b) { return a ^ b; }
+  static T or_(T a, T b) { return a | b; }
+  template <int N> static T rotl(T a) { return (a << N) | (a >> (32 - N)); }
+  template <int N> static T shr(T a) { return a >> N; }
+  static T bswap(T a) { return (a >> 24) | ((a >> 8) & 0xFF00) | ((a << 8) & 0xFF0000) | (a << 24); }
+  static T ch(T x, T y, T z) { return z ^ (x & (y ^ z)); }
+  static T maj(T x, T y, T z) { return (x & y) | (z & (x | y)); }
+  static T xor3(T x, T y, T z) { return x ^ y ^ z; }
+  static T ornot_xor(T x, T y, T z) { return (x | ~y) ^ z; }
+};
+
+template <typename V>
+using Words = uint32_t[16][V::k_lanes];
+
+// Load the block at offset from every lane, word j of lane l ends up in w[j][l]
+template <typename V>
+MB_INLINE void load_block(const uint8_t* const* data, size_t offset, Words<V>& w) {
+  if constexpr (V::k_lanes == 1) {
+    memcpy(w, data[0] + offset, mb::k_block_size);
+  } else {
+#ifdef MB_X86
+    for (size_t l = 0; l < V::k_lanes; l += 4) {
+      for (size_t j = 0; j < 16; j += 4) {
+        const auto r0 = _mm_loadu_si128((const __m128i*)(data[l + 0] + offset + j * 4));
+        const auto r1 = _mm_loadu_si128((const __m128i*)(data[l + 1] + offset + j * 4));
+        const auto r2 = _mm_loadu_si128((const __m128i*)(data[l + 2] + offset + j * 4));
+        const auto r3 = _mm_loadu_si128((const __m128i*)(data[l + 3] + offset + j * 4));
+        const auto t0 = _mm_unpacklo_epi32(r0, r1);
+        const auto t1 = _mm_unpacklo_epi32(r2, r3);
+        const auto t2 = _mm_unpackhi_epi32(r0, r1);
+        const auto t3 = _mm_unpackhi_epi32(r2, r3);
+        _mm_store_si128((__m128i*)&w[j + 0][l], _mm_unpacklo_epi64(t0, t1));
+        _mm_store_si128((__m128i*)&w[j + 1][l], _mm_unpackhi_epi64(t0, t1));
+        _mm_store_si128((__m128i*)&w[j + 2][l], _mm_unpacklo_epi64(t2, t3));
+        _mm_store_si128((__m128i*)&w[j + 3][l], _mm_unpackhi_epi64(t2, t3));
+      }
+    }
+#endif
+  }
+}
+
+// Steps are unrolled at compile time, with the state rotating through the
+// slots of an array instead of moving between variables
+
+struct Md5 {
+  static constexpr size_t k_state_words = 4;
+  static constexpr bool k_big_endian = false;
+
+  static constexpr uint32_t k_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+  };
+
+  static constexpr int k_shift[4][4] = {{7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}};
+
+  static constexpr size_t word(size_t j) {
+    switch (j / 16) {
+    case 0: return j;
+    case 1: return (5 * j + 1) % 16;
+    case 2: return (3 * j + 5) % 16;
+    default: return (7 * j) % 16;
+    }
+  }
+
+  template <typename V, size_t J>
+  MB_INLINE static void step(typename V::T (&v)[4], const typename V::T (&m)[16]) {
+    constexpr auto a = (64 - J) % 4, b = (a + 1) % 4, c = (a + 2) % 4, d = (a + 3) % 4;
+    typename V::T f;
+    if constexpr (J < 16)
+      f = V::ch(v[b], v[c], v[d]);
+    else if constexpr (J < 32)
+      f = V::ch(v[d], v[b], v[c]);
+    else if constexpr (J < 48)
+      f = V::xor3(v[b], v[c], v[d]);
+    else
+      f = V::ornot_xor(v[b], v[d], v[c]);
+    const auto sum = V::add(V::add(v[a], f), V::add(m[word(J)], V::set1(k_k[J])));
+    v[a] = V::add(v[b], V::template rotl<k_shift[J / 16][J % 4]>(sum));
+  }
+
+  template <typename V, size_t... J>
+  MB_INLINE static void steps(typename V::T (&v)[4], const typename V::T (&m)[16], std::index_sequence<J...>) {
+    (step<V, J>(v, m), ...);
+  }
+
+  template <typename V>
+  MB_INLINE static void compress(typename V::T (&s)[4], const typename V::T (&m)[16]) {
+    typename V::T v[4] = {s[0], s[1], s[2], s[3]};
+    steps<V>(v, m, std::make_index_sequence<64>{});
+    for (size_t i = 0; i < 4; ++i)
+      s[i] = V::add(s[i], v[i]);
+  }
+};
+
+struct Sha1 {
+  static constexpr size_t k_state_words = 5;
+  static constexpr bool k_big_endian = true;
+
+  template <typename V, size_t J>
+  MB_INLINE static void step(typename V::T (&v)[5], typename V::T (&w)[16]) {
+    constexpr auto a = (80 - J) % 5, b = (a + 1) % 5, c = (a + 2) % 5, d = (a + 3) % 5, e = (a + 4) % 5;
+    if constexpr (J >= 16)
+      w[J % 16] = V::template rotl<1>(V::xor_(V::xor3(w[(J - 3) % 16], w[(J - 8) % 16], w[(J - 14) % 16]), w[J % 16]));
+    typename V::T f;
+    uint32_t k;
+    if constexpr (J < 20)
+      f = V::ch(v[b], v[c], v[d]), k = 0x5A827999;
+    else if constexpr (J < 40)
+      f = V::xor3(v[b], v[c], v[d]), k = 0x6ED9EBA1;
+    else if constexpr (J < 60)
+      f = V::maj(v[b], v[c], v[d]), k = 0x8F1BBCDC;
+    else
+      f = V::xor3(v[b], v[c], v[d]), k = 0xCA62C1D6;
+    v[e] = V::add(V::add(v[e], V::template rotl<5>(v[a])), V::add(f, V::add(w[J % 16], V::set1(k))));
+    v[b] = V::template rotl<30>(v[b]);
+  }
+
+  template <typename V, size_t... J>
+  MB_INLINE static void steps(typename V::T (&v)[5], typename V::T (&w)[16], std::index_sequence<J...>) {
+    (step<V, J>(v, w), ...);
+  }
+
+  template <typename V>
+  MB_INLINE static void compress(typename V::T (&s)[5], const typename V::T (&m)[16]) {
+    typename V::T w[16];
+    for (size_t i = 0; i < 16; ++i)
+      w[i] = m[i];
+    typename V::T v[5] = {s[0], s[1], s[2], s[3], s[4]};
+    steps<V>(v, w, std::make_index_sequence<80>{});
+    for (size_t i = 0; i < 5; ++i)
+      s[i] = V::add(s[i], v[i]);
+  }
+};
+
+struct Sha256 {
+  static constexpr size_t k_state_words = 8;
+  static constexpr bool k_big_endian = true;
+
+  static constexpr uint32_t k_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+  };
+
+  template <typename V, size_t J>
+  MB_INLINE static void step(typename V::T (&v)[8], typename V::T (&w)[16]) {
+    constexpr auto a = (64 - J) % 8, b = (a + 1) % 8, c = (a + 2) % 8, d = (a + 3) % 8;
+    constexpr auto e = (a + 4) % 8, f = (a + 5) % 8, g = (a + 6) % 8, h = (a + 7) % 8;
+    if constexpr (J >= 16) {
+      const auto w15 = w[(J - 15) % 16];
+      const auto w2 = w[(J - 2) % 16];
+      const auto s0 = V::xor3(V::template rotl<25>(w15), V::template rotl<14>(w15), V::template shr<3>(w15));
+      const auto s1 = V::xor3(V::template rotl<15>(w2), V::template rotl<13>(w2), V::template shr<10>(w2));
+      w[J % 16] = V::add(V::add(w[J % 16], s0), V::add(w[(J - 7) % 16], s1));
+    }
+    const auto s1 = V::xor3(V::template rotl<26>(v[e]), V::template rotl<21>(v[e]), V::template rotl<7>(v[e]));
+    const auto t1 = V::add(V::add(v[h], s1), V::add(V::ch(v[e], v[f], v[g]), V::add(w[J % 16], V::set1(k_k[J]))));
+    const auto s0 = V::xor3(V::template rotl<30>(v[a]), V::template rotl<19>(v[a]), V::template rotl<10>(v[a]));
+    v[d] = V::add(v[d], t1);
+    v[h] = V::add(t1, V::add(s0, V::maj(v[a], v[b], v[c])));
+  }
+
+  template <typename V, size_t... J>
+  MB_INLINE static void steps(typename V::T (&v)[8], typename V::T (&w)[16], std::index_sequence<J...>) {
+    (step<V, J>(v, w), ...);
+  }
+
+  template <typename V>
+  MB_INLINE static void compress(typename V::T (&s)[8], const typename V::T (&m)[16]) {
+    typename V::T w[16];
+    for (size_t i = 0; i < 16; ++i)
+      w[i] = m[i];
+    typename V::T v[8];
+    for (size_t i = 0; i < 8; ++i)
+      v[i] = s[i];
+    steps<V>(v, w, std::make_index_sequence<64>{});
+    for (size_t i = 0; i < 8; ++i)
+      s[i] = V::add(s[i], v[i]);
+  }
+};
+
+struct RipeMD160 {
+  static constexpr size_t k_state_words = 5;
+  static constexpr bool k_big_endian = false;
+
+  static constexpr uint8_t k_word[2][80] = {
+    {
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+      7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+      3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+      1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+      4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13,
+    },
+    {
+      5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+      6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+      15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+      8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+      12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11,
+    },
+  };
+
+  static constexpr uint8_t k_shift[2][80] = {
+    {
+      11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+      7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+      11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+      11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+      9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6,
+    },
+    {
+      8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+      9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+      9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+      15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+      8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11,
+    },
+  };
+
+  static constexpr uint32_t k_k[2][5] = {
+    {0x00000000, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E},
+    {0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0x00000000},
+  };
+
+  // Line 0 is the left line, line 1 the right one which uses the functions
+  // in reverse order
+  template <typename V, size_t Line, size_t J>
+  MB_INLINE static void step(typename V::T (&v)[5], const typename V::T (&m)[16]) {
+    constexpr auto a = (80 - J) % 5, b = (a + 1) % 5, c = (a + 2) % 5, d = (a + 3) % 5, e = (a + 4) % 5;
+    constexpr auto round = Line == 0 ? J / 16 : 4 - J / 16;
+    typename V::T f;
+    if constexpr (round == 0)
+      f = V::xor3(v[b], v[c], v[d]);
+    else if constexpr (round == 1)
+      f = V::ch(v[b], v[c], v[d]);
+    else if constexpr (round == 2)
+      f = V::ornot_xor(v[b], v[c], v[d]);
+    else if constexpr (round == 3)
+      f = V::ch(v[d], v[b], v[c]);
+    else
+      f = V::ornot_xor(v[c], v[d], v[b]);
+    auto sum = V::add(V::add(v[a], f), m[k_word[Line][J]]);
+    if constexpr (k_k[Line][J / 16] != 0)
+      sum = V::add(sum, V::set1(k_k[Line][J / 16]));
+    v[a] = V::add(V::template rotl<k_shift[Line][J]>(sum), v[e]);
+    v[c] = V::template rotl<10>(v[c]);
+  }
+
+  template <typename V, size_t Line, size_t... J>
+  MB_INLINE static void steps(typename V::T (&v)[5], const typename V::T (&m)[16], std::index_sequence<J...>) {
+    (step<V, Line, J>(v, m), ...);
+  }
+
+  template <typename V>
+  MB_INLINE static void compress(typename V::T (&s)[5], const typename V::T (&m)[16]) {
+    typename V::T l[5] = {s[0], s[1], s[2], s[3], s[4]};
+    typename V::T r[5] = {s[0], s[1], s[2], s[3], s[4]};
+    steps<V, 0>(l, m, std::make_index_sequence<80>{});
+    steps<V, 1>(r, m, std::make_index_sequence<80>{});
+    // After 80 steps the roles are back in their original slots
+    const auto t = V::add(V::add(s[1], l[2]), r[3]);
+    s[1] = V::add(V::add(s[2], l[3]), r[4]);
+    s[2] = V::add(V::add(s[3], l[4]), r[0]);
+    s[3] = V::add(V::add(s[4], l[0]), r[1]);
+    s[4] = V::add(V::add(s[0], l[1]), r[2]);
+    s[0] = t;
+  }
+};
+
+// Hash the same number of blocks on all lanes of V
+template <typename Algo, typename V>
+void hash_lanes(uint32_t* const* states, const uint8_t* const* data, size_t blocks) {
+  using T = typename V::T;
+  constexpr auto n = Algo::k_state_words;
+
+  alignas(64) uint32_t tmp[n][V::k_lanes];
+  for (size_t l = 0; l < V::k_lanes; ++l)
+    for (size_t i = 0; i < n; ++i)
+      tmp[i][l] = states[l][i];
+
+  T s[n];
+  for (size_t i = 0; i < n; ++i)
+    s[i] = V::load(tmp[i]);
+
+  alignas(64) Words<V> w;
+  T m[16];
+  for (size_t block = 0; block < blocks; ++block) {
+    load_block<V>(data, block * mb::k_block_size, w);
+    for (size_t j = 0; j < 16; ++j)
+      m[j] = Algo::k_big_endian ? V::bswap(V::load(w[j])) : V::load(w[j]);
+    Algo::template compress<V>(s, m);
+  }
+
+  for (size_t i = 0; i < n; ++i)
+    V::store(tmp[i], s[i]);
+  for (size_t l = 0; l < V::k_lanes; ++l)
+    for (size_t i = 0; i < n; ++i)
+      states[l][i] = tmp[i][l];
+}
+
+template <typename Algo, typename V>
+void hash_many(mb::Stream* streams, size_t count) {
+  if constexpr (V::k_lanes == 1) {
+    for (size_t i = 0; i < count; ++i)
+      hash_lanes<Algo, VecScalar>(&streams[i].state, &streams[i].data, streams[i].blocks);
+  } else {
+    uint32_t scratch[Algo::k_state_words]{};
+    uint32_t* states[V::k_lanes];
+    const uint8_t* data[V::k_lanes];
+    size_t left[V::k_lanes];
+    size_t active = 0;
+    size_t next = 0;
+
+    while (true) {
+      for (; active < V::k_lanes && next < count; ++next) {
+        const auto& stream = streams[next];
+        if (!stream.blocks)
+          continue;
+        states[active] = stream.state;
+        data[active] = stream.data;
+        left[active] = stream.blocks;
+        ++active;
+      }
+
+      // A single stream is faster on its own than in a mostly empty vector
+      if (active < 2)
+        break;
+
+      auto step = left[0];
+      for (size_t i = 1; i < active; ++i)
+        step = left[i] < step ? left[i] : step;
+
+      // Idle lanes hash the first lane's data into a scratch state
+      for (auto i = active; i < V::k_lanes; ++i) {
+        states[i] = scratch;
+        data[i] = data[0];
+      }
+
+      hash_lanes<Algo, V>(states, data, step);
+
+      size_t kept = 0;
+      for (size_t i = 0; i < active; ++i) {
+        if (left[i] == step)
+          continue;
+        states[kept] = states[i];
+        data[kept] = data[i] + step * mb::k_block_size;
+        left[kept] = left[i] - step;
+        ++kept;
+      }
+      active = kept;
+    }
+
+    if (active)
+      hash_lanes<Algo, VecScalar>(states, data, left[0]);
+  }
+}
+
+template <typename V>
+constexpr mb::Kernels make_kernels() {
+  return {
+    V::k_lanes,
+    &hash_many<Md5, V>,
+    &hash_many<Sha1, V>,
+    &hash_many<Sha256, V>,
+    &hash_many<RipeMD160, V>,
+  };
+}
+
+}
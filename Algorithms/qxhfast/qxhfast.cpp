@@ -0,0 +1,149 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "qxhfast.h"
+
+#include <array>
+#include <cstring>
+
+#include <cpufeatures.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define QXHFAST_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define QXHFAST_TARGET_SSE2
+#define QXHFAST_TARGET_AVX2
+#else
+#define QXHFAST_TARGET_SSE2 __attribute__((target("sse2")))
+#define QXHFAST_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace qxhfast {
+
+namespace {
+
+// Bit of the state that the low bit of lane i starts at
+constexpr auto k_schedule = [] {
+  std::array<uint8_t, k_lanes> out{};
+  for (size_t i = 0; i < k_lanes; ++i)
+    out[i] = (uint8_t)(i * 11 % (k_size * 8));
+  return out;
+}();
+
+void xor_bytes(State* state, const uint8_t* p, size_t n) {
+  auto lane = (size_t)(state->length % k_lanes);
+  for (size_t i = 0; i < n; ++i) {
+    state->lanes[lane] ^= p[i];
+    if (++lane == k_lanes)
+      lane = 0;
+  }
+  state->length += n;
+}
+
+// XORs in bytes until the next one goes to lane 0, returns how many
+size_t xor_head(State* state, const uint8_t* p, size_t n) {
+  const auto lane = (size_t)(state->length % k_lanes);
+  if (!lane)
+    return 0;
+  const auto head = n < k_lanes - lane ? n : k_lanes - lane;
+  xor_bytes(state, p, head);
+  return head;
+}
+
+#ifdef QXHFAST_X86
+
+QXHFAST_TARGET_SSE2 void update_sse2(State* state, const void* data, size_t size) {
+  auto p = (const uint8_t*)data;
+  const auto head = xor_head(state, p, size);
+  p += head;
+  size -= head;
+
+  constexpr size_t k_vectors = k_lanes / 16;
+  const auto blocks = size / k_lanes;
+  if (blocks) {
+    __m128i x[k_vectors];
+    for (size_t i = 0; i < k_vectors; ++i)
+      x[i] = _mm_loadu_si128((const __m128i*)(state->lanes + i * 16));
+    for (size_t n = 0; n < blocks; ++n, p += k_lanes)
+      for (size_t i = 0; i < k_vectors; ++i)
+        x[i] = _mm_xor_si128(x[i], _mm_loadu_si128((const __m128i*)(p + i * 16)));
+    for (size_t i = 0; i < k_vectors; ++i)
+      _mm_storeu_si128((__m128i*)(state->lanes + i * 16), x[i]);
+    state->length += blocks * k_lanes;
+  }
+
+  xor_bytes(state, p, size % k_lanes);
+}
+
+QXHFAST_TARGET_AVX2 void update_avx2(State* state, const void* data, size_t size) {
+  auto p = (const uint8_t*)data;
+  const auto head = xor_head(state, p, size);
+  p += head;
+  size -= head;
+
+  constexpr size_t k_vectors = k_lanes / 32;
+  const auto blocks = size / k_lanes;
+  if (blocks) {
+    __m256i x[k_vectors];
+    for (size_t i = 0; i < k_vectors; ++i)
+      x[i] = _mm256_loadu_si256((const __m256i*)(state->lanes + i * 32));
+    for (size_t n = 0; n < blocks; ++n, p += k_lanes)
+      for (size_t i = 0; i < k_vectors; ++i)
+        x[i] = _mm256_xor_si256(x[i], _mm256_loadu_si256((const __m256i*)(p + i * 32)));
+    for (size_t i = 0; i < k_vectors; ++i)
+      _mm256_storeu_si256((__m256i*)(state->lanes + i * 32), x[i]);
+    state->length += blocks * k_lanes;
+  }
+
+  xor_bytes(state, p, size % k_lanes);
+}
+
+#endif
+
+}
+
+UpdateFn* update_simd() {
+#ifdef QXHFAST_X86
+  // SSE2 is the baseline of every x86 flavor
+  if (cpu_has(CPU_FEATURE_AVX2))
+    return update_avx2;
+  return update_sse2;
+#else
+  return nullptr;
+#endif
+}
+
+void init(State* state) {
+  memset(state, 0, sizeof(*state));
+}
+
+void final(const State* state, uint8_t* out) {
+  uint8_t hash[k_size]{};
+  for (size_t i = 0; i < k_lanes; ++i) {
+    const auto byte = k_schedule[i] / 8;
+    const auto bits = k_schedule[i] % 8;
+    hash[byte] ^= (uint8_t)(state->lanes[i] << bits);
+    if (bits)
+      hash[(byte + 1) % k_size] ^= (uint8_t)(state->lanes[i] >> (8 - bits));
+  }
+  for (size_t i = 0; i < 8; ++i)
+    hash[k_size - 8 + i] ^= (uint8_t)(state->length >> (i * 8));
+  memcpy(out, hash, k_size);
+}
+
+}
@@ -0,0 +1,45 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// QuickXorHash with vector XORs. Byte n of the message always lands on bit
+// n * 11 mod 160 of the state, so the message is first XORed into 160 byte
+// lanes, one for every position mod 160, at memory speed. The lanes are only
+// shifted into the 160 bit state when finishing. The output is the same as
+// qxhash_final, which stays the fallback.
+
+namespace qxhfast {
+
+constexpr size_t k_size = 20;
+constexpr size_t k_lanes = 160;
+
+struct State {
+  // lanes[i] is the XOR of every message byte at a position i mod 160
+  uint8_t lanes[k_lanes];
+  uint64_t length;
+};
+
+using UpdateFn = void(State* state, const void* data, size_t size);
+
+// This returns nullptr if there is no vector kernel for the CPU.
+UpdateFn* update_simd();
+
+void init(State* state);
+void final(const State* state, uint8_t* out);
+
+}
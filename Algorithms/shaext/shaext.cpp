@@ -0,0 +1,417 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "shaext.h"
+
+#include <utility>
+
+#include <cpufeatures.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SHAEXT_X86
+#include <immintrin.h>
+#if defined(_M_X64) || defined(__x86_64__)
+#define SHAEXT_X64
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define SHAEXT_ARM64
+#include <arm_neon.h>
+#endif
+
+// The kernels are compiled for instructions the flavor may not have, so they
+// and everything inlined into them carry a target attribute.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SHAEXT_INLINE __forceinline
+#define SHAEXT_TARGET_X86
+#define SHAEXT_TARGET_AVX2
+#define SHAEXT_TARGET_ARM64
+#else
+#define SHAEXT_INLINE inline __attribute__((always_inline))
+#define SHAEXT_TARGET_X86 __attribute__((target("sha,sse4.1")))
+#define SHAEXT_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2")))
+#if defined(__clang__)
+#define SHAEXT_TARGET_ARM64 __attribute__((target("sha2")))
+#else
+#define SHAEXT_TARGET_ARM64 __attribute__((target("+sha2")))
+#endif
+#endif
+
+namespace {
+
+constexpr uint32_t k_sha1[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+alignas(16) constexpr uint32_t k_sha256[64] = {
+  0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+  0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+  0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+  0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+  0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+  0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+  0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+  0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+// Both instruction sets work on groups of four rounds, with the message
+// schedule kept in four registers that each hold four words. Group G consumes
+// m[G % 4] and the schedule refills the slots it's done with a few groups
+// ahead.
+
+#ifdef SHAEXT_X86
+
+struct Sha1X86 {
+  // The first group adds the message to E, the rest get it through sha1nexte
+  // from the A of four rounds before
+  template <size_t G>
+  SHAEXT_TARGET_X86 SHAEXT_INLINE static void group(__m128i& abcd, __m128i (&e)[2], __m128i (&m)[4]) {
+    if constexpr (G == 0)
+      e[0] = _mm_add_epi32(e[0], m[0]);
+    else
+      e[G % 2] = _mm_sha1nexte_epu32(e[G % 2], m[G % 4]);
+    e[(G + 1) % 2] = abcd;
+    if constexpr (G >= 3 && G <= 18)
+      m[(G + 1) % 4] = _mm_sha1msg2_epu32(m[(G + 1) % 4], m[G % 4]);
+    abcd = _mm_sha1rnds4_epu32(abcd, e[G % 2], G / 5);
+    if constexpr (G >= 1 && G <= 16)
+      m[(G - 1) % 4] = _mm_sha1msg1_epu32(m[(G - 1) % 4], m[G % 4]);
+    if constexpr (G >= 2 && G <= 17)
+      m[(G - 2) % 4] = _mm_xor_si128(m[(G - 2) % 4], m[G % 4]);
+  }
+
+  template <size_t... G>
+  SHAEXT_TARGET_X86 SHAEXT_INLINE static void groups(__m128i& abcd, __m128i (&e)[2], __m128i (&m)[4], std::index_sequence<G...>) {
+    (group<G>(abcd, e, m), ...);
+  }
+
+  SHAEXT_TARGET_X86 static void blocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+    const auto mask = _mm_set_epi64x(0x0001020304050607, 0x08090A0B0C0D0E0F);
+
+    auto abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+    auto e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+    for (; blocks; --blocks, data += shaext::k_block_size) {
+      const auto abcd_save = abcd;
+      const auto e_save = e0;
+
+      __m128i m[4];
+      for (size_t i = 0; i < 4; ++i)
+        m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), mask);
+
+      __m128i e[2] = { e0, e0 };
+      groups(abcd, e, m, std::make_index_sequence<20>{});
+
+      e0 = _mm_sha1nexte_epu32(e[0], e_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+  }
+};
+
+struct Sha256X86 {
+  template <size_t G>
+  SHAEXT_TARGET_X86 SHAEXT_INLINE static void group(__m128i& abef, __m128i& cdgh, __m128i (&m)[4]) {
+    auto wk = _mm_add_epi32(m[G % 4], _mm_load_si128((const __m128i*)&k_sha256[G * 4]));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+    if constexpr (G >= 3 && G <= 14) {
+      auto& next = m[(G + 1) % 4];
+      next = _mm_add_epi32(next, _mm_alignr_epi8(m[G % 4], m[(G + 3) % 4], 4));
+      next = _mm_sha256msg2_epu32(next, m[G % 4]);
+    }
+    wk = _mm_shuffle_epi32(wk, 0x0E);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, wk);
+    if constexpr (G >= 1 && G <= 12)
+      m[(G + 3) % 4] = _mm_sha256msg1_epu32(m[(G + 3) % 4], m[G % 4]);
+  }
+
+  template <size_t... G>
+  SHAEXT_TARGET_X86 SHAEXT_INLINE static void groups(__m128i& abef, __m128i& cdgh, __m128i (&m)[4], std::index_sequence<G...>) {
+    (group<G>(abef, cdgh, m), ...);
+  }
+
+  SHAEXT_TARGET_X86 static void blocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+    const auto mask = _mm_set_epi64x(0x0C0D0E0F08090A0B, 0x0405060700010203);
+
+    // The round instructions want the state as ABEF and CDGH
+    const auto dcba = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);
+    const auto hgfe = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B);
+    auto abef = _mm_alignr_epi8(dcba, hgfe, 8);
+    auto cdgh = _mm_blend_epi16(hgfe, dcba, 0xF0);
+
+    for (; blocks; --blocks, data += shaext::k_block_size) {
+      const auto abef_save = abef;
+      const auto cdgh_save = cdgh;
+
+      __m128i m[4];
+      for (size_t i = 0; i < 4; ++i)
+        m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), mask);
+
+      groups(abef, cdgh, m, std::make_index_sequence<16>{});
+
+      abef = _mm_add_epi32(abef, abef_save);
+      cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    const auto feba = _mm_shuffle_epi32(abef, 0x1B);
+    const auto dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(dchg, feba, 8));
+  }
+};
+
+bool has_sha_ni() {
+  return cpu_has(CPU_FEATURE_SHA | CPU_FEATURE_SSE41 | CPU_FEATURE_SSSE3);
+}
+
+#endif
+
+#ifdef SHAEXT_X64
+
+alignas(32) constexpr uint64_t k_sha512[80] = {
+  0x428A2F98D728AE22, 0x7137449123EF65CD, 0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
+  0x3956C25BF348B538, 0x59F111F1B605D019, 0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
+  0xD807AA98A3030242, 0x12835B0145706FBE, 0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
+  0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1, 0x9BDC06A725C71235, 0xC19BF174CF692694,
+  0xE49B69C19EF14AD2, 0xEFBE4786384F25E3, 0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
+  0x2DE92C6F592B0275, 0x4A7484AA6EA6E483, 0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
+  0x983E5152EE66DFAB, 0xA831C66D2DB43210, 0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
+  0xC6E00BF33DA88FC2, 0xD5A79147930AA725, 0x06CA6351E003826F, 0x142929670A0E6E70,
+  0x27B70A8546D22FFC, 0x2E1B21385C26C926, 0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
+  0x650A73548BAF63DE, 0x766A0ABB3C77B2A8, 0x81C2C92E47EDAEE6, 0x92722C851482353B,
+  0xA2BFE8A14CF10364, 0xA81A664BBC423001, 0xC24B8B70D0F89791, 0xC76C51A30654BE30,
+  0xD192E819D6EF5218, 0xD69906245565A910, 0xF40E35855771202A, 0x106AA07032BBD1B8,
+  0x19A4C116B8D2D0C8, 0x1E376C085141AB53, 0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
+  0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB, 0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
+  0x748F82EE5DEFB2FC, 0x78A5636F43172F60, 0x84C87814A1F0AB72, 0x8CC702081A6439EC,
+  0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9, 0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
+  0xCA273ECEEA26619C, 0xD186B8C721C0C207, 0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
+  0x06F067AA72176FBA, 0x0A637DC5A2C898A6, 0x113F9804BEF90DAE, 0x1B710B35131C471B,
+  0x28DB77F523047D84, 0x32CAAB7B40C72493, 0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
+  0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A, 0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817,
+};
+
+// SHA-512 has no instructions on most CPUs, but its words are wide enough
+// that four of them fill an AVX2 register. The schedule makes four words at
+// a time there, the rounds run on general purpose registers with RORX and
+// ANDN. They only need W + K, which the schedule stores for them a few
+// groups ahead.
+struct Sha512Avx2 {
+  template <int N>
+  SHAEXT_TARGET_AVX2 SHAEXT_INLINE static uint64_t ror(uint64_t x) {
+    return (x >> N) | (x << (64 - N));
+  }
+
+  template <int N>
+  SHAEXT_TARGET_AVX2 SHAEXT_INLINE static __m256i ror(__m256i x) {
+    return _mm256_or_si256(_mm256_srli_epi64(x, N), _mm256_slli_epi64(x, 64 - N));
+  }
+
+  SHAEXT_TARGET_AVX2 SHAEXT_INLINE static __m256i sigma1(__m256i x) {
+    return _mm256_xor_si256(_mm256_xor_si256(ror<19>(x), ror<61>(x)), _mm256_srli_epi64(x, 6));
+  }
+
+  // W[16..19] from W[0..15], with the words of the registers in order. The
+  // second half needs sigma1 of the first.
+  SHAEXT_TARGET_AVX2 SHAEXT_INLINE static __m256i schedule(__m256i w0, __m256i w4, __m256i w8, __m256i w12) {
+    const auto w1 = _mm256_alignr_epi8(_mm256_permute2x128_si256(w0, w4, 0x21), w0, 8);
+    const auto w9 = _mm256_alignr_epi8(_mm256_permute2x128_si256(w8, w12, 0x21), w8, 8);
+    const auto sigma0 = _mm256_xor_si256(_mm256_xor_si256(ror<1>(w1), ror<8>(w1)), _mm256_srli_epi64(w1, 7));
+    const auto sum = _mm256_add_epi64(_mm256_add_epi64(w0, w9), sigma0);
+    const auto lo = _mm256_add_epi64(sum, _mm256_permute2x128_si256(sigma1(w12), sigma1(w12), 0x81));
+    return _mm256_add_epi64(lo, _mm256_permute2x128_si256(sigma1(lo), sigma1(lo), 0x08));
+  }
+
+  // The state rotates through s instead of being moved, A of round R is in
+  // s[-R % 8]
+  template <size_t R>
+  SHAEXT_TARGET_AVX2 SHAEXT_INLINE static void round(uint64_t (&s)[8], const uint64_t* wk) {
+    constexpr auto a = (0 - R) % 8, b = (1 - R) % 8, c = (2 - R) % 8, d = (3 - R) % 8;
+    constexpr auto e = (4 - R) % 8, f = (5 - R) % 8, g = (6 - R) % 8, h = (7 - R) % 8;
+    const auto t1 = s[h] + (ror<14>(s[e]) ^ ror<18>(s[e]) ^ ror<41>(s[e])) + ((s[e] & s[f]) ^ (~s[e] & s[g])) + wk[R % 4];
+    const auto t2 = (ror<28>(s[a]) ^ ror<34>(s[a]) ^ ror<39>(s[a])) + ((s[a] & s[b]) ^ (s[c] & (s[a] ^ s[b])));
+    s[d] += t1;
+    s[h] = t1 + t2;
+  }
+
+  template <size_t G>
+  SHAEXT_TARGET_AVX2 SHAEXT_INLINE static void group(uint64_t (&s)[8], __m256i (&w)[4], uint64_t (&wk)[80]) {
+    if constexpr (G < 16) {
+      const auto next = schedule(w[G % 4], w[(G + 1) % 4], w[(G + 2) % 4], w[(G + 3) % 4]);
+      w[G % 4] = next;
+      const auto k = _mm256_load_si256((const __m256i*)&k_sha512[G * 4 + 16]);
+      _mm256_store_si256((__m256i*)&wk[G * 4 + 16], _mm256_add_epi64(next, k));
+    }
+    round<G * 4 + 0>(s, &wk[G * 4]);
+    round<G * 4 + 1>(s, &wk[G * 4]);
+    round<G * 4 + 2>(s, &wk[G * 4]);
+    round<G * 4 + 3>(s, &wk[G * 4]);
+  }
+
+  template <size_t... G>
+  SHAEXT_TARGET_AVX2 SHAEXT_INLINE static void groups(uint64_t (&s)[8], __m256i (&w)[4], uint64_t (&wk)[80], std::index_sequence<G...>) {
+    (group<G>(s, w, wk), ...);
+  }
+
+  SHAEXT_TARGET_AVX2 static void blocks(uint64_t* state, const uint8_t* data, size_t blocks) {
+    const auto mask = _mm256_set_epi64x(0x08090A0B0C0D0E0F, 0x0001020304050607, 0x08090A0B0C0D0E0F, 0x0001020304050607);
+
+    for (; blocks; --blocks, data += shaext::k_block_size_512) {
+      alignas(32) uint64_t wk[80];
+      __m256i w[4];
+      for (size_t i = 0; i < 4; ++i) {
+        w[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(data + i * 32)), mask);
+        const auto k = _mm256_load_si256((const __m256i*)&k_sha512[i * 4]);
+        _mm256_store_si256((__m256i*)&wk[i * 4], _mm256_add_epi64(w[i], k));
+      }
+
+      uint64_t s[8];
+      for (size_t i = 0; i < 8; ++i)
+        s[i] = state[i];
+
+      groups(s, w, wk, std::make_index_sequence<20>{});
+
+      for (size_t i = 0; i < 8; ++i)
+        state[i] += s[i];
+    }
+  }
+};
+
+#endif
+
+#ifdef SHAEXT_ARM64
+
+struct Sha1Arm64 {
+  template <size_t G>
+  SHAEXT_TARGET_ARM64 SHAEXT_INLINE static void group(uint32x4_t& abcd, uint32_t& e, uint32x4_t (&m)[4]) {
+    const auto wk = vaddq_u32(m[G % 4], vdupq_n_u32(k_sha1[G / 5]));
+    const auto next_e = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+    if constexpr (G < 5)
+      abcd = vsha1cq_u32(abcd, e, wk);
+    else if constexpr (G >= 10 && G < 15)
+      abcd = vsha1mq_u32(abcd, e, wk);
+    else
+      abcd = vsha1pq_u32(abcd, e, wk);
+    e = next_e;
+    if constexpr (G < 16)
+      m[G % 4] = vsha1su1q_u32(vsha1su0q_u32(m[G % 4], m[(G + 1) % 4], m[(G + 2) % 4]), m[(G + 3) % 4]);
+  }
+
+  template <size_t... G>
+  SHAEXT_TARGET_ARM64 SHAEXT_INLINE static void groups(uint32x4_t& abcd, uint32_t& e, uint32x4_t (&m)[4], std::index_sequence<G...>) {
+    (group<G>(abcd, e, m), ...);
+  }
+
+  SHAEXT_TARGET_ARM64 static void blocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+    auto abcd = vld1q_u32(state);
+    auto e0 = state[4];
+
+    for (; blocks; --blocks, data += shaext::k_block_size) {
+      const auto abcd_save = abcd;
+      const auto e_save = e0;
+
+      uint32x4_t m[4];
+      for (size_t i = 0; i < 4; ++i)
+        m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+
+      uint32_t e = e0;
+      groups(abcd, e, m, std::make_index_sequence<20>{});
+
+      abcd = vaddq_u32(abcd, abcd_save);
+      e0 = e + e_save;
+    }
+
+    vst1q_u32(state, abcd);
+    state[4] = e0;
+  }
+};
+
+struct Sha256Arm64 {
+  template <size_t G>
+  SHAEXT_TARGET_ARM64 SHAEXT_INLINE static void group(uint32x4_t& abcd, uint32x4_t& efgh, uint32x4_t (&m)[4]) {
+    const auto wk = vaddq_u32(m[G % 4], vld1q_u32(&k_sha256[G * 4]));
+    if constexpr (G < 12)
+      m[G % 4] = vsha256su0q_u32(m[G % 4], m[(G + 1) % 4]);
+    const auto abcd_prev = abcd;
+    abcd = vsha256hq_u32(abcd, efgh, wk);
+    efgh = vsha256h2q_u32(efgh, abcd_prev, wk);
+    if constexpr (G < 12)
+      m[G % 4] = vsha256su1q_u32(m[G % 4], m[(G + 2) % 4], m[(G + 3) % 4]);
+  }
+
+  template <size_t... G>
+  SHAEXT_TARGET_ARM64 SHAEXT_INLINE static void groups(uint32x4_t& abcd, uint32x4_t& efgh, uint32x4_t (&m)[4], std::index_sequence<G...>) {
+    (group<G>(abcd, efgh, m), ...);
+  }
+
+  SHAEXT_TARGET_ARM64 static void blocks(uint32_t* state, const uint8_t* data, size_t blocks) {
+    auto abcd = vld1q_u32(&state[0]);
+    auto efgh = vld1q_u32(&state[4]);
+
+    for (; blocks; --blocks, data += shaext::k_block_size) {
+      const auto abcd_save = abcd;
+      const auto efgh_save = efgh;
+
+      uint32x4_t m[4];
+      for (size_t i = 0; i < 4; ++i)
+        m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+
+      groups(abcd, efgh, m, std::make_index_sequence<16>{});
+
+      abcd = vaddq_u32(abcd, abcd_save);
+      efgh = vaddq_u32(efgh, efgh_save);
+    }
+
+    vst1q_u32(&state[0], abcd);
+    vst1q_u32(&state[4], efgh);
+  }
+};
+
+#endif
+
+} // namespace
+
+namespace shaext {
+
+BlocksFn* sha1_blocks() {
+#if defined(SHAEXT_X86)
+  if (has_sha_ni())
+    return &Sha1X86::blocks;
+#elif defined(SHAEXT_ARM64)
+  if (cpu_has(CPU_FEATURE_ARM_SHA1))
+    return &Sha1Arm64::blocks;
+#endif
+  return nullptr;
+}
+
+BlocksFn* sha256_blocks() {
+#if defined(SHAEXT_X86)
+  if (has_sha_ni())
+    return &Sha256X86::blocks;
+#elif defined(SHAEXT_ARM64)
+  if (cpu_has(CPU_FEATURE_ARM_SHA2))
+    return &Sha256Arm64::blocks;
+#endif
+  return nullptr;
+}
+
+Blocks512Fn* sha512_blocks() {
+#if defined(SHAEXT_X64)
+  if (cpu_has(CPU_FEATURE_AVX2 | CPU_FEATURE_BMI1 | CPU_FEATURE_BMI2))
+    return &Sha512Avx2::blocks;
+#endif
+  return nullptr;
+}
+
+}
@@ -0,0 +1,39 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// SHA-1 and SHA-256 block functions on the CPU's SHA extensions, SHA-NI on x86
+// and the ARMv8 cryptographic extension on ARM64. Like the multi-buffer
+// kernels they only process whole 64 byte blocks, the state is in the same
+// layout as mbedtls's. SHA-512, for 128 byte blocks, runs on AVX2 and BMI2
+// instead, on x64.
+
+namespace shaext {
+
+constexpr size_t k_block_size = 64;
+constexpr size_t k_block_size_512 = 128;
+
+using BlocksFn = void(uint32_t* state, const uint8_t* data, size_t blocks);
+using Blocks512Fn = void(uint64_t* state, const uint8_t* data, size_t blocks);
+
+// These return nullptr if the CPU doesn't have the instructions.
+BlocksFn* sha1_blocks();
+BlocksFn* sha256_blocks();
+Blocks512Fn* sha512_blocks();
+
+}
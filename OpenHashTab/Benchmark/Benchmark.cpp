@@ -22,7 +22,145 @@
 
 #include <Hasher.h>
 
+#ifndef NDEBUG
+// The examples of GOST R 34.11-2012, M1 and M2 with the byte order of the
+// bundled implementation. They go through whichever kernel the CPU gets.
+static void CheckKnownAnswers() {
+  static constexpr const char k_m1[] = "012345678901234567890123456789012345678901234567890123456789012";
+  static constexpr const char k_m2[] =
+      "\xd1\xe5\x20\xe2\xe5\xf2\xf0\xe8\x2c\x20\xd1\xf2\xf0\xe8\xe1\xee\xe6\xe8\x20\xe2\xed\xf3\xf6\xe8"
+      "\x2c\x20\xe2\xe5\xfe\xf2\xfa\x20\xf1\x20\xec\xee\xf0\xff\x20\xf1\xf2\xf0\xe5\xeb\xe0\xec\xe8\x20"
+      "\xed\xe0\x20\xf5\xf0\xe0\xe1\xf0\xfb\xff\x20\xef\xeb\xfa\xea\xfb\x20\xc8\xe3\xee\xf0\xe5\xe2\xfb";
+
+  static constexpr struct {
+    const char* algorithm;
+    const char* message;
+    size_t size;
+    const char* hash;
+  } k_answers[] = {
+    {"GOST 2012 (512)", k_m1, sizeof(k_m1) - 1,
+     "1b54d01a4af5b9d5cc3d86d68d285462b19abc2475222f35c085122be4ba1ffa"
+     "00ad30f8767b3a82384c6574f024c311e2a481332b08ef7f41797891c1646f48"},
+    {"GOST 2012 (256)", k_m1, sizeof(k_m1) - 1,
+     "9d151eefd8590b89daa6ba6cb74af9275dd051026bb149a452fd84e5e57b5500"},
+    {"GOST 2012 (512)", k_m2, sizeof(k_m2) - 1,
+     "1e88e62226bfca6f9994f1f2d51569e0daf8475a3b0fe61a5300eee46d961376"
+     "035fe83549ada2b8620fcd7c496ce5b33f0cb9dddc2b6460143b03dabac9fb28"},
+    {"GOST 2012 (256)", k_m2, sizeof(k_m2) - 1,
+     "9dd2fe4e90409e5da87f53976d7405b0c0cac628fc669a741d50063c557e8f50"},
+  };
+
+  for (const auto& answer : k_answers) {
+    auto ctx = LegacyHashAlgorithm::ByName(answer.algorithm)->MakeContext();
+    // Byte by byte too, so that the buffering is checked
+    auto split_ctx = LegacyHashAlgorithm::ByName(answer.algorithm)->MakeContext();
+    ctx.Update(answer.message, answer.size);
+    for (auto i = 0u; i < answer.size; ++i)
+      split_ctx.Update(answer.message + i, 1);
+
+    uint8_t hash[LegacyHashAlgorithm::k_max_size];
+    uint8_t split_hash[LegacyHashAlgorithm::k_max_size];
+    ctx.Finish(hash);
+    split_ctx.Finish(split_hash);
+
+    char hex[LegacyHashAlgorithm::k_max_size * 2 + 1]{};
+    for (auto i = 0u; i < ctx.GetOutputSize(); ++i) {
+      hex[i * 2] = "0123456789abcdef"[hash[i] >> 4];
+      hex[i * 2 + 1] = "0123456789abcdef"[hash[i] & 0xF];
+    }
+    assert(0 == strcmp(hex, answer.hash));
+    assert(0 == memcmp(hash, split_hash, ctx.GetOutputSize()));
+  }
+}
+#endif
+
+// Compares the pipeline feeding each algorithm of a preset the whole block on
+// its own, against one worker walking it in tiles for all of them
+static void BenchmarkPreset(LARGE_INTEGER frequency) {
+  static constexpr const char* k_preset[] = {"CRC32", "XXH3-64", "MD5", "SHA-1"};
+  static constexpr auto k_passes = 5u;
+  // Much bigger than any cache, walked in pipeline sized blocks
+  static constexpr auto k_size = 256ull << 20;
+  static constexpr auto k_block_size = 2ull << 20;
+
+  const auto p = (uint8_t*)VirtualAlloc(
+    nullptr,
+    k_size,
+    MEM_RESERVE | MEM_COMMIT,
+    PAGE_READWRITE
+  );
+
+  if (!p) {
+    printf("VirtualAlloc failed.");
+    return;
+  }
+
+  std::mt19937_64 engine{0}; // NOLINT(cert-msc51-cpp)
+  std::generate_n((uint64_t*)p, k_size / sizeof(uint64_t), [&engine] { return engine(); });
+
+  static constexpr auto k_count = std::size(k_preset);
+
+  int64_t fan_out[k_passes]{};
+  int64_t fused[k_passes]{};
+
+  for (auto i = 0u; i < k_passes; ++i) {
+    HashBox fan_out_boxes[k_count];
+    HashBox fused_boxes[k_count];
+    HashBox* fused_box_ptrs[k_count];
+    for (auto j = 0u; j < k_count; ++j) {
+      const auto algorithm = LegacyHashAlgorithm::ByName(k_preset[j]);
+      fan_out_boxes[j] = algorithm->MakeContext();
+      fused_boxes[j] = algorithm->MakeContext();
+      fused_box_ptrs[j] = &fused_boxes[j];
+    }
+
+    LARGE_INTEGER begin{}, end{};
+
+    // Total CPU time of each algorithm hashing every block by itself
+    QueryPerformanceCounter(&begin);
+    for (auto offset = 0ull; offset < k_size; offset += k_block_size)
+      for (auto& box : fan_out_boxes)
+        box.Update(p + offset, k_block_size);
+    QueryPerformanceCounter(&end);
+    fan_out[i] = end.QuadPart - begin.QuadPart;
+
+    QueryPerformanceCounter(&begin);
+    for (auto offset = 0ull; offset < k_size; offset += k_block_size)
+      HashBox::UpdateFused(fused_box_ptrs, k_count, p + offset, k_block_size);
+    QueryPerformanceCounter(&end);
+    fused[i] = end.QuadPart - begin.QuadPart;
+
+#ifndef NDEBUG
+    for (auto j = 0u; j < k_count; ++j) {
+      uint8_t fan_out_hash[LegacyHashAlgorithm::k_max_size];
+      uint8_t fused_hash[LegacyHashAlgorithm::k_max_size];
+      fan_out_boxes[j].Finish(fan_out_hash);
+      fused_boxes[j].Finish(fused_hash);
+      assert(0 == memcmp(fan_out_hash, fused_hash, fan_out_boxes[j].GetOutputSize()));
+    }
+#endif
+  }
+
+  VirtualFree(p, 0, MEM_RELEASE);
+
+  std::sort(std::begin(fan_out), std::end(fan_out));
+  std::sort(std::begin(fused), std::end(fused));
+
+  const auto to_mbps = [&](int64_t ticks) {
+    return (double)(k_size * frequency.QuadPart) / (double)ticks / (1ll << 20);
+  };
+
+  // Median of the passes
+  printf("\nCRC32 + XXH3-64 + MD5 + SHA-1, per core\n");
+  printf("%-16s\t%.7lf MB/s\n", "Fan-out", to_mbps(fan_out[k_passes / 2]));
+  printf("%-16s\t%.7lf MB/s\n", "Fused", to_mbps(fused[k_passes / 2]));
+}
+
 int main() {
+#ifndef NDEBUG
+  CheckKnownAnswers();
+#endif
+
   static constexpr auto k_passes = 20u;
   // 4 MB so that it fits in (my) L2 cache
   static constexpr auto k_size = 4ull << 20;
@@ -121,5 +259,7 @@ int main() {
     printf("%.7lf MB/s\n", mbps);
   }
 
+  BenchmarkPreset(frequency);
+
   return 0;
 }
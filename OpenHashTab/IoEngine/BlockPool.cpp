@@ -0,0 +1,561 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#include "BlockPool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <thread>
+
+#include "IoEngine.h"
+
+#ifdef _WIN32
+
+// Committing charges the pagefile, so it's done a block at a time on use
+static constexpr bool k_reserve_commits = false;
+
+static bool EnableLockMemoryPrivilege() {
+  HANDLE token;
+  if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+    return false;
+
+  TOKEN_PRIVILEGES tp{};
+  tp.PrivilegeCount = 1;
+  tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+  // AdjustTokenPrivileges succeeds with ERROR_NOT_ALL_ASSIGNED if we don't hold it
+  const auto ok = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid)
+                  && AdjustTokenPrivileges(token, FALSE, &tp, 0, nullptr, nullptr)
+                  && GetLastError() == ERROR_SUCCESS;
+
+  CloseHandle(token);
+  return ok;
+}
+
+static void* AllocateLargePages(size_t size) {
+  if (!EnableLockMemoryPrivilege())
+    return nullptr;
+  // Large pages can't be committed on demand, so they are all committed now
+  const auto large_page = std::max<size_t>(GetLargePageMinimum(), 1);
+  return VirtualAlloc(
+    nullptr,
+    (size + large_page - 1) / large_page * large_page,
+    MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+    PAGE_READWRITE
+  );
+}
+
+static void* ReserveMemory(size_t size) {
+  return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+}
+
+static bool CommitMemory(void* p, size_t size) {
+  return nullptr != VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE);
+}
+
+static void DecommitMemory(void* p, size_t size) {
+  VirtualFree(p, size, MEM_DECOMMIT);
+}
+
+static void ResetMemory(void* p, size_t size) {
+  VirtualAlloc(p, size, MEM_RESET, PAGE_READWRITE);
+  // We don't care about errors
+}
+
+static bool ReleaseMemory(void* p, size_t size) {
+  (void)size;
+  return VirtualFree(p, 0, MEM_RELEASE);
+}
+
+struct BlockPool::MemoryWatch {
+  HANDLE low{};
+  HANDLE high{};
+  PTP_WAIT wait{};
+
+  static VOID NTAPI Callback(
+    _Inout_ PTP_CALLBACK_INSTANCE instance,
+    _Inout_opt_ PVOID ctx,
+    _Inout_ PTP_WAIT wait,
+    _In_ TP_WAIT_RESULT wait_result
+  ) {
+    UNREFERENCED_PARAMETER(instance);
+    UNREFERENCED_PARAMETER(wait_result);
+
+    const auto pool = static_cast<BlockPool*>(ctx);
+
+    const auto low = !pool->_memory_low;
+    pool->SetMemoryLow(low);
+
+    // Wait for the other notification, so we don't fire again while the state holds
+    SetThreadpoolWait(wait, low ? pool->_memory_watch->high : pool->_memory_watch->low, nullptr);
+  }
+
+  ~MemoryWatch() {
+    if (wait) {
+      SetThreadpoolWait(wait, nullptr, nullptr);
+      WaitForThreadpoolWaitCallbacks(wait, TRUE);
+      CloseThreadpoolWait(wait);
+    }
+    if (low)
+      CloseHandle(low);
+    if (high)
+      CloseHandle(high);
+  }
+};
+
+void BlockPool::WatchMemoryPressure() {
+  const auto watch = new MemoryWatch;
+  _memory_watch = watch;
+
+  watch->low = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+  watch->high = CreateMemoryResourceNotification(HighMemoryResourceNotification);
+  if (!watch->low || !watch->high)
+    return;
+
+  watch->wait = CreateThreadpoolWait(MemoryWatch::Callback, this, nullptr);
+  if (watch->wait)
+    SetThreadpoolWait(watch->wait, watch->low, nullptr);
+}
+
+#else
+
+// Anonymous mappings are only backed on first touch, so there is nothing to
+// gain from committing later
+static constexpr bool k_reserve_commits = true;
+
+static void* AllocateLargePages(size_t size) {
+#ifdef MAP_HUGETLB
+  // Fails unless huge pages were reserved, budget is a multiple of their size
+  const auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  return p == MAP_FAILED ? nullptr : p;
+#else
+  (void)size;
+  return nullptr;
+#endif
+}
+
+static void* ReserveMemory(size_t size) {
+  const auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return p == MAP_FAILED ? nullptr : p;
+}
+
+static bool CommitMemory(void* p, size_t size) {
+  (void)p;
+  (void)size;
+  return true;
+}
+
+static void DecommitMemory(void* p, size_t size) {
+  madvise(p, size, MADV_DONTNEED);
+}
+
+static void ResetMemory(void* p, size_t size) {
+#ifdef MADV_FREE
+  madvise(p, size, MADV_FREE);
+#else
+  (void)p;
+  (void)size;
+#endif
+  // We don't care about errors
+}
+
+static bool ReleaseMemory(void* p, size_t size) {
+  return 0 == munmap(p, size);
+}
+
+#ifdef __linux__
+
+// Memory is low once some task stalled on it for this long within the window.
+// Unprivileged triggers need the window to be a multiple of 2 s
+static constexpr char k_psi_trigger[] = "some 150000 2000000";
+
+// Memory is fine again once the trigger didn't fire for this long
+static constexpr int k_psi_calm_ms = 10000;
+
+struct BlockPool::MemoryWatch {
+  int psi{-1};
+  int stop{-1};
+  std::thread thread;
+
+  ~MemoryWatch() {
+    if (thread.joinable()) {
+      const uint64_t one = 1;
+      (void)!write(stop, &one, sizeof(one));
+      thread.join();
+    }
+    if (psi >= 0)
+      close(psi);
+    if (stop >= 0)
+      close(stop);
+  }
+};
+
+void BlockPool::WatchMemoryPressure() {
+  const auto watch = new MemoryWatch;
+  _memory_watch = watch;
+
+  // Without PSI in the kernel, there is nothing to watch
+  watch->psi = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (watch->psi < 0 || write(watch->psi, k_psi_trigger, sizeof(k_psi_trigger)) < 0)
+    return;
+
+  watch->stop = eventfd(0, EFD_CLOEXEC);
+  if (watch->stop < 0)
+    return;
+
+  watch->thread = std::thread([this, watch] {
+    pollfd fds[2]{{watch->psi, POLLPRI, 0}, {watch->stop, POLLIN, 0}};
+    while (true) {
+      const auto ret = poll(fds, 2, _memory_low ? k_psi_calm_ms : -1);
+      if (ret < 0 && errno == EINTR)
+        continue;
+      // The trigger is gone along with its cgroup, or we are stopping
+      if (ret < 0 || fds[0].revents & POLLERR || fds[1].revents)
+        return;
+      const auto low = (fds[0].revents & POLLPRI) != 0;
+      if (low != _memory_low)
+        SetMemoryLow(low);
+    }
+  });
+}
+
+#else
+
+struct BlockPool::MemoryWatch {};
+
+void BlockPool::WatchMemoryPressure() {}
+
+#endif
+
+#endif
+
+void BlockPool::SetMemoryLow(bool low) {
+  std::lock_guard guard{_mutex};
+  _memory_low = low;
+  UpdateLimitLocked();
+  if (low)
+    DecommitFreeLocked();
+}
+
+void BlockPool::UpdateLimitLocked() {
+  _limit = _memory_low ? std::max(_budget / k_low_memory_divisor, k_max_block_size) : _budget;
+}
+
+BlockPool::BlockPool(size_t budget, bool large_pages, bool reset_freed, IoEngine* engine)
+    : _budget{RoundBudget(budget)}
+    , _limit{_budget}
+    , _large_pages{large_pages}
+    , _reset_freed{reset_freed}
+    , _engine{engine}
+    , _next_budget{_budget}
+    , _next_large_pages{large_pages}
+    , _next_reset_freed{reset_freed} {
+  std::fill(std::begin(_free_head), std::end(_free_head), k_none);
+}
+
+BlockPool::~BlockPool() {
+  {
+    std::lock_guard guard{_mutex};
+    _stopping = true;
+  }
+  _idle_cv.notify_one();
+  if (_idle_thread.joinable())
+    _idle_thread.join();
+
+  delete _memory_watch;
+
+  assert(_bytes_in_use == 0);
+  ReleaseLocked();
+}
+
+unsigned BlockPool::OrderFor(size_t size) {
+  auto order = 0u;
+  while ((k_min_block_size << order) < size)
+    ++order;
+  return order;
+}
+
+size_t BlockPool::RoundBudget(size_t budget) {
+  return std::max(budget, k_max_block_size) / k_max_block_size * k_max_block_size;
+}
+
+void BlockPool::Configure(size_t budget, bool large_pages, bool reset_freed) {
+  std::lock_guard guard{_mutex};
+  _next_budget = RoundBudget(budget);
+  _next_large_pages = large_pages;
+  _next_reset_freed = reset_freed;
+}
+
+bool BlockPool::ReserveLocked() {
+  // No block is out, so nothing depends on the old settings
+  _budget = _next_budget;
+  _large_pages = _next_large_pages;
+  _reset_freed = _next_reset_freed;
+  UpdateLimitLocked();
+
+  auto size = _budget;
+
+  if (_large_pages) {
+    _base = static_cast<uint8_t*>(AllocateLargePages(size));
+    _base_large_pages = _base != nullptr;
+  }
+
+  // Address space may be fragmented on 32 bit, so settle for less if needed
+  while (!_base && size >= k_max_block_size) {
+    _base = static_cast<uint8_t*>(ReserveMemory(size));
+    if (!_base)
+      size = size / 2 / k_max_block_size * k_max_block_size;
+  }
+
+  if (!_base)
+    return false;
+
+  _size = size;
+  const auto units = (uint32_t)(_size / k_min_block_size);
+  _next.assign(units, k_none);
+  _prev.assign(units, k_none);
+  _free_order.assign(units, -1);
+  _committed.assign(units, _base_large_pages || k_reserve_commits);
+
+  const auto windows = WindowOf(units - 1) + 1;
+  _window_blocks.assign(windows, 0);
+  _window_pinned.assign(windows, 0);
+
+  // The engine pins windows when they are first used, so they have to be
+  // committed already. Pages of a window are then locked and mapped once for
+  // all reads into it, until the arena is released or memory runs low
+  _base_registered = _engine
+                     && (_base_large_pages || k_reserve_commits)
+                     && _engine->RegisterBuffers(_base, _size, k_pin_window_size);
+  _pin_failed = false;
+
+  // Lowest addresses first, so a small job stays in few windows
+  constexpr auto max_order = k_orders - 1;
+  for (auto unit = units; unit != 0;) {
+    unit -= 1u << max_order;
+    PushFreeLocked(unit, max_order);
+  }
+
+  if (!_idle_thread.joinable())
+    _idle_thread = std::thread{[this] { ReleaseWhenIdle(); }};
+
+  return true;
+}
+
+void BlockPool::ReleaseLocked() {
+  if (!_base)
+    return;
+
+  // Every block is back, so no reads are in flight into the arena. This also
+  // unpins every window
+  if (_base_registered)
+    _engine->UnregisterBuffers();
+
+  const auto ret = ReleaseMemory(_base, _size);
+  (void)ret;
+  assert(ret);
+
+  _base = nullptr;
+  _size = 0;
+  _base_large_pages = false;
+  _base_registered = false;
+  std::fill(std::begin(_free_head), std::end(_free_head), k_none);
+}
+
+void BlockPool::PushFreeLocked(uint32_t unit, unsigned order) {
+  _free_order[unit] = (int8_t)order;
+  _prev[unit] = k_none;
+  _next[unit] = _free_head[order];
+  if (_free_head[order] != k_none)
+    _prev[_free_head[order]] = unit;
+  _free_head[order] = unit;
+}
+
+void BlockPool::RemoveFreeLocked(uint32_t unit, unsigned order) {
+  _free_order[unit] = -1;
+  if (_prev[unit] != k_none)
+    _next[_prev[unit]] = _next[unit];
+  else
+    _free_head[order] = _next[unit];
+  if (_next[unit] != k_none)
+    _prev[_next[unit]] = _prev[unit];
+}
+
+void BlockPool::DecommitFreeLocked() {
+  // Large pages can't be decommitted
+  if (!_base || _base_large_pages)
+    return;
+
+  // Neither can pinned ones, nothing is read into windows without blocks out
+  for (size_t window = 0; window < _window_pinned.size(); ++window)
+    if (_window_pinned[window] && _window_blocks[window] == 0) {
+      _engine->UnpinBuffers(window);
+      _window_pinned[window] = 0;
+    }
+
+  for (auto order = 0u; order < k_orders; ++order)
+    for (auto unit = _free_head[order]; unit != k_none; unit = _next[unit]) {
+      if (_window_pinned[WindowOf(unit)])
+        continue;
+
+      const auto begin = _committed.begin() + unit;
+      const auto end = begin + (1u << order);
+      if (std::find(begin, end, (uint8_t)1) == end)
+        continue;
+
+      DecommitMemory(_base + (size_t)unit * k_min_block_size, k_min_block_size << order);
+      std::fill(begin, end, (uint8_t)0);
+    }
+}
+
+bool BlockPool::Commit(uint32_t unit, unsigned order) {
+  const auto end = unit + (1u << order);
+  for (auto i = unit; i < end;) {
+    if (_committed[i]) {
+      ++i;
+      continue;
+    }
+
+    auto run_end = i + 1;
+    while (run_end < end && !_committed[run_end])
+      ++run_end;
+
+    if (!CommitMemory(_base + (size_t)i * k_min_block_size, (size_t)(run_end - i) * k_min_block_size))
+      return false;
+
+    std::fill(_committed.begin() + i, _committed.begin() + run_end, (uint8_t)1);
+    i = run_end;
+  }
+  return true;
+}
+
+BlockPool::Block BlockPool::TryAllocate(size_t size) {
+  const auto order = OrderFor(size);
+  if (order >= k_orders)
+    return {};
+
+  uint32_t unit;
+  {
+    std::lock_guard guard{_mutex};
+
+    if (_bytes_in_use + (k_min_block_size << order) > _limit)
+      return {};
+
+    if (!_base && !ReserveLocked())
+      return {};
+
+    auto found = order;
+    while (found < k_orders && _free_head[found] == k_none)
+      ++found;
+    if (found == k_orders)
+      return {};
+
+    unit = _free_head[found];
+    RemoveFreeLocked(unit, found);
+
+    // Split until it's the size we need, freeing the upper halves
+    while (found > order) {
+      --found;
+      PushFreeLocked(unit + (1u << found), found);
+    }
+
+    _bytes_in_use += k_min_block_size << order;
+
+    // Windows are committed already if the arena is registered
+    const auto window = WindowOf(unit);
+    ++_window_blocks[window];
+    if (_base_registered && !_window_pinned[window] && !_pin_failed) {
+      _window_pinned[window] = _engine->PinBuffers(window);
+      _pin_failed = !_window_pinned[window];
+    }
+  }
+
+  const Block block{_base + (size_t)unit * k_min_block_size, k_min_block_size << order};
+
+  if (!Commit(unit, order)) {
+    Free(block);
+    return {};
+  }
+
+  return block;
+}
+
+void BlockPool::Reset(Block block) const {
+  // Large and pinned pages are never paged out anyways
+  const auto unit = (uint32_t)((size_t)(block.data - _base) / k_min_block_size);
+  if (!_reset_freed || _base_large_pages || _window_pinned[WindowOf(unit)])
+    return;
+
+  ResetMemory(block.data, block.size);
+}
+
+void BlockPool::Free(Block block) {
+  std::lock_guard guard{_mutex};
+
+  auto unit = (uint32_t)((size_t)(block.data - _base) / k_min_block_size);
+  auto order = OrderFor(block.size);
+
+  _bytes_in_use -= block.size;
+  --_window_blocks[WindowOf(unit)];
+
+  // Merge with the buddy as long as it's free too
+  while (order + 1 < k_orders) {
+    const auto buddy = unit ^ (1u << order);
+    if (buddy >= _free_order.size() || _free_order[buddy] != (int8_t)order)
+      break;
+    RemoveFreeLocked(buddy, order);
+    unit = std::min(unit, buddy);
+    ++order;
+  }
+
+  PushFreeLocked(unit, order);
+
+  // Don't keep memory around for long while nothing is being hashed
+  if (_bytes_in_use == 0) {
+    _idle_since = std::chrono::steady_clock::now();
+    _idle_cv.notify_one();
+  }
+}
+
+void BlockPool::ReleaseWhenIdle() {
+  std::unique_lock lock{_mutex};
+  while (!_stopping) {
+    if (!_base || _bytes_in_use != 0) {
+      _idle_cv.wait(lock);
+      continue;
+    }
+
+    const auto deadline = _idle_since + k_idle_release;
+    if (std::chrono::steady_clock::now() >= deadline)
+      ReleaseLocked();
+    else
+      _idle_cv.wait_until(lock, deadline);
+  }
+}
@@ -0,0 +1,157 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class IoEngine;
+
+// Fixed arena of memory handed out in power of two sized blocks, recycled
+// without going back to the OS. The arena is reserved on first use and
+// released once no block was out for a while. While the system is low on
+// memory, less of the arena is handed out and free blocks are decommitted.
+class BlockPool {
+public:
+  struct Block {
+    uint8_t* data{};
+    size_t size{};
+
+    explicit operator bool() const { return data != nullptr; }
+  };
+
+  // Block sizes are powers of two between these
+  static constexpr size_t k_min_block_size = 64 << 10; // 64 KB
+  static constexpr unsigned k_orders = 9;              // up to 16 MB
+  static constexpr size_t k_max_block_size = k_min_block_size << (k_orders - 1);
+
+  // Part of the budget that may be used while the system is low on memory
+  static constexpr size_t k_low_memory_divisor = 4;
+
+  // The engine pins the arena in windows of this size, as blocks in them are
+  // first handed out. A multiple of the largest block, so none straddles two
+  static constexpr size_t k_pin_window_size = 32 << 20; // 32 MB
+
+  // The arena is released once no block was out for this long, so jobs
+  // following each other don't reserve and pin it again
+  static constexpr auto k_idle_release = std::chrono::seconds(10);
+
+private:
+  static constexpr uint32_t k_none = UINT32_MAX;
+
+  std::mutex _mutex;
+
+  // Settings of the current arena, only changed while it's released
+  size_t _budget;
+  size_t _limit;
+  bool _large_pages;
+  bool _reset_freed;
+  IoEngine* _engine;
+
+  // Settings for the next time the arena is reserved
+  size_t _next_budget;
+  bool _next_large_pages;
+  bool _next_reset_freed;
+
+  uint8_t* _base{};
+  size_t _size{};
+  size_t _bytes_in_use{};
+  bool _base_large_pages{};
+  bool _base_registered{}; // with the engine, which pins windows of it
+  bool _pin_failed{};      // ran into the limit on locked memory
+
+  std::vector<uint32_t> _window_blocks; // blocks out in each window
+  std::vector<uint8_t> _window_pinned;  // constant while the window has blocks out
+
+  std::condition_variable _idle_cv;
+  std::thread _idle_thread;
+  std::chrono::steady_clock::time_point _idle_since;
+  bool _stopping{};
+
+  // Free blocks of each order form a doubly linked list through these, indexed
+  // by the first k_min_block_size unit of the block
+  uint32_t _free_head[k_orders]{};
+  std::vector<uint32_t> _next;
+  std::vector<uint32_t> _prev;
+  std::vector<int8_t> _free_order; // order of the free block starting here, or -1
+  std::vector<uint8_t> _committed; // only touched by the owner of the unit
+
+  // Low memory notifications of the OS, if it has any. Only the watch changes
+  // whether memory is low
+  struct MemoryWatch;
+  MemoryWatch* _memory_watch{};
+  bool _memory_low{};
+
+  // Hand out less of the arena and give free blocks back while memory is low
+  void SetMemoryLow(bool low);
+  void UpdateLimitLocked();
+
+  static unsigned OrderFor(size_t size);
+
+  static size_t RoundBudget(size_t budget);
+
+  static size_t WindowOf(uint32_t unit) { return unit / (k_pin_window_size / k_min_block_size); }
+
+  bool ReserveLocked();
+  void ReleaseLocked();
+
+  void PushFreeLocked(uint32_t unit, unsigned order);
+  void RemoveFreeLocked(uint32_t unit, unsigned order);
+
+  // Commit any pages of the block that were never committed
+  bool Commit(uint32_t unit, unsigned order);
+
+  // Give the memory of free blocks back to the OS, unpinning windows without
+  // blocks out
+  void DecommitFreeLocked();
+
+  void ReleaseWhenIdle();
+
+public:
+  BlockPool(const BlockPool&) = delete;
+  BlockPool(BlockPool&&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+  BlockPool& operator=(BlockPool&&) = delete;
+
+  // Large pages need SeLockMemoryPrivilege on Windows and reserved huge pages
+  // on Linux, without them we silently use normal pages. Resetting tells the OS
+  // it doesn't have to page out freed blocks, which costs a syscall per block.
+  // If engine is given, the arena is registered with it while reserved.
+  BlockPool(size_t budget, bool large_pages, bool reset_freed, IoEngine* engine = nullptr);
+  ~BlockPool();
+
+  // Change the settings given on construction. The arena keeps its settings
+  // while reserved, new ones take effect once it has been released
+  void Configure(size_t budget, bool large_pages, bool reset_freed);
+
+  // Returns a block of at least size bytes, or nothing if the pool is exhausted
+  Block TryAllocate(size_t size);
+
+  // Optionally tell the OS we don't care about the contents of the block
+  void Reset(Block block) const;
+
+  void Free(Block block);
+
+  // Start shrinking the pool on low memory notifications, or memory pressure
+  // stall information on Linux. Call at most once. Does nothing where the OS
+  // has neither
+  void WatchMemoryPressure();
+};
@@ -0,0 +1,312 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+// Reads files through the I/O engine of the platform, scheduled per device
+// into blocks of the pool like the hashing pipeline does, and reports
+// throughput. Usage: IoBenchmark [-m budget_mb] [-b block_kb] [-a] [-c r|s]
+// [-u] [-l] files...
+//   -a  pick the block size per file and device like the pipeline, with
+//       block_kb as the usual size. Otherwise every read is block_kb
+//   -c  treat every device as remote (r) or slow to seek (s)
+//   -u  bypass the OS cache, to measure the device rather than memory
+//   -l  use large pages for the pool
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "BlockPool.h"
+#include "IoEngine.h"
+#include "ReadQueues.h"
+
+struct BenchFile {
+  IoNativeHandle handle{};
+  IoFile* io{};
+  ReadDevice* device{};
+  uint64_t size{};
+  uint64_t next_offset{};
+  size_t block_size{};
+};
+
+struct BenchRead {
+  IoRequest request{};
+  BlockPool::Block block{};
+  BenchFile* file{};
+};
+
+struct DeviceClass {
+  bool remote{};
+  bool seek_penalty{};
+};
+
+static IoEngine* g_engine;
+static BlockPool* g_pool;
+static ReadQueues<BenchFile> g_read_queues;
+static std::vector<BenchFile> g_files;
+static size_t g_block_size = 2 << 20;
+static bool g_adaptive{};
+static bool g_unbuffered{};
+static DeviceClass g_class_override{};
+
+// Unbuffered reads must be aligned to the sector size, this covers all of them
+static constexpr size_t k_unbuffered_alignment = 4096;
+static unsigned g_in_flight{};
+static uint64_t g_reads{};
+static uint64_t g_bytes{};
+static uint32_t g_error{};
+static std::mutex g_mutex;
+static std::condition_variable g_done;
+
+#ifndef _WIN32
+static DeviceClass QueryDeviceClass(dev_t dev) {
+  DeviceClass result;
+  char path[64];
+  // Partitions don't have a queue of their own, the disk they are on does
+  for (const auto format : {"/sys/dev/block/%u:%u/queue/rotational", "/sys/dev/block/%u:%u/../queue/rotational"}) {
+    snprintf(path, sizeof(path), format, major(dev), minor(dev));
+    if (const auto f = fopen(path, "r")) {
+      result.seek_penalty = fgetc(f) == '1';
+      fclose(f);
+      break;
+    }
+  }
+  return result;
+}
+#endif
+
+static bool OpenFile(const char* path, BenchFile& file) {
+#ifdef _WIN32
+  file.handle = CreateFileA(
+    path,
+    GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | (g_unbuffered ? FILE_FLAG_NO_BUFFERING : 0),
+    nullptr
+  );
+  BY_HANDLE_FILE_INFORMATION fi{};
+  if (file.handle == INVALID_HANDLE_VALUE || !GetFileInformationByHandle(file.handle, &fi))
+    return false;
+  file.size = (uint64_t)fi.nFileSizeHigh << 32 | fi.nFileSizeLow;
+  file.device = g_read_queues.GetDevice(fi.dwVolumeSerialNumber, [] { return g_class_override; });
+#else
+  file.handle = open(path, O_RDONLY | (g_unbuffered ? O_DIRECT : 0));
+  struct stat st {};
+  if (file.handle < 0 || fstat(file.handle, &st) != 0)
+    return false;
+  file.size = (uint64_t)st.st_size;
+  file.device = g_read_queues.GetDevice(st.st_dev, [&] {
+    auto result = QueryDeviceClass(st.st_dev);
+    result.remote |= g_class_override.remote;
+    result.seek_penalty |= g_class_override.seek_penalty;
+    return result;
+  });
+#endif
+  file.block_size = g_adaptive ? file.device->BlockSizeFor(file.size, g_block_size) : g_block_size;
+  return true;
+}
+
+static void CloseFile(BenchFile& file) {
+#ifdef _WIN32
+  CloseHandle(file.handle);
+#else
+  close(file.handle);
+#endif
+}
+
+// Start reads on the file until it's done, its device is busy or the pool
+// runs dry, reusing the block if given. Expects g_mutex to be held, returns
+// whether the file has to wait and whether it was for memory
+static bool IssueReadsLocked(BenchFile& file, bool& memory, BlockPool::Block& reuse_block) {
+  memory = false;
+  while (file.next_offset < file.size && !g_error) {
+    if (!g_read_queues.TryAcquireRead(file.device))
+      return true;
+
+    // A block from another file is only good if it's not much bigger than we need
+    if (reuse_block && (reuse_block.size < file.block_size || reuse_block.size > std::bit_ceil(std::max(file.block_size, g_block_size)))) {
+      g_pool->Free(reuse_block);
+      reuse_block = {};
+    }
+
+    const auto block = reuse_block ? std::exchange(reuse_block, {}) : g_pool->TryAllocate(file.block_size);
+    if (!block) {
+      g_read_queues.ReleaseRead(file.device);
+      memory = true;
+      return true;
+    }
+
+    const auto read = new BenchRead{{}, block, &file};
+    const auto size = (size_t)std::min<uint64_t>(file.size - file.next_offset, file.block_size);
+    // The tail of the file is read whole, the block always has room for it
+    const auto read_size = g_unbuffered ? (size + k_unbuffered_alignment - 1) / k_unbuffered_alignment * k_unbuffered_alignment : size;
+    const auto error = g_engine->Read(file.io, &read->request, block.data, read_size, file.next_offset);
+    if (error) {
+      g_read_queues.ReleaseRead(file.device);
+      g_pool->Free(block);
+      delete read;
+      if (g_engine->IsTransientError(error)) {
+        memory = true;
+        return true;
+      }
+      g_error = error;
+      return false;
+    }
+
+    file.next_offset += size;
+    ++g_in_flight;
+    ++g_reads;
+  }
+  return false;
+}
+
+// Every file with data left waits in the queue of its device, start reads on
+// them round-robin over devices. Expects g_mutex to be held. Handing over the
+// block of a finished read keeps the pool from going idle in between
+static void ProcessReadQueueLocked(BlockPool::Block reuse_block = {}) {
+  while (const auto file = g_read_queues.Dequeue()) {
+    bool memory;
+    if (IssueReadsLocked(*file, memory, reuse_block))
+      g_read_queues.Enqueue(file->device, file);
+    // Other devices won't find memory either
+    if (memory)
+      break;
+  }
+  if (reuse_block)
+    g_pool->Free(reuse_block);
+}
+
+static void Completion(void* ctx, IoRequest* request, uint32_t error, size_t bytes_transferred) {
+  (void)ctx;
+  // IoRequest is the first member of the read
+  const auto read = reinterpret_cast<BenchRead*>(request);
+
+  std::lock_guard guard{g_mutex};
+  --g_in_flight;
+  g_read_queues.ReleaseRead(read->file->device);
+  const auto block = read->block;
+  delete read;
+  g_bytes += bytes_transferred;
+  if (error && !g_error)
+    g_error = error;
+  ProcessReadQueueLocked(block);
+  if (g_in_flight == 0)
+    g_done.notify_all();
+}
+
+int main(int argc, char** argv) {
+  size_t budget = 32 << 20;
+  bool large_pages = false;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; ++i) {
+    if (0 == strcmp(argv[i], "-l"))
+      large_pages = true;
+    else if (0 == strcmp(argv[i], "-a"))
+      g_adaptive = true;
+    else if (0 == strcmp(argv[i], "-u"))
+      g_unbuffered = true;
+    else if (i + 1 == argc)
+      break;
+    else if (0 == strcmp(argv[i], "-m"))
+      budget = (size_t)std::max(atoi(argv[++i]), 1) << 20;
+    else if (0 == strcmp(argv[i], "-b"))
+      g_block_size = std::min((size_t)std::max(atoi(argv[++i]), 4) << 10, BlockPool::k_max_block_size);
+    else if (0 == strcmp(argv[i], "-c"))
+      (argv[++i][0] == 'r' ? g_class_override.remote : g_class_override.seek_penalty) = true;
+  }
+
+  if (g_unbuffered)
+    g_block_size = (g_block_size + k_unbuffered_alignment - 1) / k_unbuffered_alignment * k_unbuffered_alignment;
+
+  if (i == argc) {
+    printf("Usage: %s [-m budget_mb] [-b block_kb] [-a] [-c r|s] [-u] [-l] files...\n", argv[0]);
+    return 1;
+  }
+
+  g_engine = IoEngine::Default();
+  if (!g_engine) {
+    printf("No I/O engine available.\n");
+    return 1;
+  }
+
+  // The pool registers its arena with the engine while any block is out
+  g_pool = new BlockPool(budget, large_pages, false, g_engine);
+
+  g_files.resize((size_t)(argc - i));
+  for (size_t j = 0; j < g_files.size(); ++j) {
+    if (!OpenFile(argv[i + (int)j], g_files[j])) {
+      printf("Can't open %s\n", argv[i + (int)j]);
+      return 1;
+    }
+    g_files[j].io = g_engine->Attach(g_files[j].handle, Completion, nullptr);
+    if (!g_files[j].io) {
+      printf("Can't attach %s\n", argv[i + (int)j]);
+      return 1;
+    }
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  {
+    std::unique_lock lock{g_mutex};
+    for (auto& file : g_files)
+      if (file.size)
+        g_read_queues.Enqueue(file.device, &file);
+    ProcessReadQueueLocked();
+    g_done.wait(lock, [] { return g_in_flight == 0; });
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  for (auto& file : g_files) {
+    g_engine->Detach(file.io);
+    CloseFile(file);
+  }
+
+  delete g_pool;
+
+  if (g_error) {
+    printf("Read failed with error %u\n", g_error);
+    return 1;
+  }
+
+  const auto seconds = std::chrono::duration<double>(end - begin).count();
+  printf(
+    "%llu bytes in %llu reads, %.3f s: %.1f MB/s\n",
+    (unsigned long long)g_bytes,
+    (unsigned long long)g_reads,
+    seconds,
+    (double)g_bytes / seconds / 1e6
+  );
+  return 0;
+}
@@ -0,0 +1,91 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Asynchronous file reads, independent of the mechanism the OS provides for
+// them. On Windows this is thread pool I/O on top of IOCP, on Linux io_uring.
+
+#ifdef _WIN32
+using IoNativeHandle = void*; // HANDLE opened with FILE_FLAG_OVERLAPPED
+#else
+using IoNativeHandle = int;
+#endif
+
+// State of a single read, owned by the caller. It must stay alive and
+// untouched until the read completes.
+struct IoRequest {
+  // Engine specific, OVERLAPPED on Windows
+  uint64_t engine_data[4]{};
+};
+
+struct IoFile;
+
+class IoEngine {
+public:
+  // Called exactly once for each started read, on a thread of the engine. error
+  // is a Win32 error code on Windows and an errno value elsewhere
+  using Callback = void (*)(void* ctx, IoRequest* request, uint32_t error, size_t bytes_transferred);
+
+  IoEngine() = default;
+  IoEngine(const IoEngine&) = delete;
+  IoEngine(IoEngine&&) = delete;
+  IoEngine& operator=(const IoEngine&) = delete;
+  IoEngine& operator=(IoEngine&&) = delete;
+  virtual ~IoEngine() = default;
+
+  // Start delivering completions of reads on handle to callback. The handle
+  // stays owned by the caller. Returns nullptr and sets the last error on failure
+  virtual IoFile* Attach(IoNativeHandle handle, Callback callback, void* ctx) = 0;
+
+  // There must be no reads in flight on the file. May be called from the
+  // file's own completion callback, as long as it doesn't touch it afterwards
+  virtual void Detach(IoFile* file) = 0;
+
+  // Memory most reads will go to, split into windows of window_size bytes.
+  // Engines that can pin buffers read into pinned windows with less overhead,
+  // others ignore all this. Nothing is pinned yet, and no reads may be in
+  // flight. Returns whether windows can be pinned
+  virtual bool RegisterBuffers(void* base, size_t size, size_t window_size) {
+    (void)base;
+    (void)size;
+    (void)window_size;
+    return false;
+  }
+  virtual void UnregisterBuffers() {}
+
+  // Pin a window of the registered memory, reads elsewhere may be in flight.
+  // All of the window must be committed. Returns false if the OS refused, for
+  // example for a limit on locked memory
+  virtual bool PinBuffers(size_t window) {
+    (void)window;
+    return false;
+  }
+
+  // No reads may be in flight into the window
+  virtual void UnpinBuffers(size_t window) { (void)window; }
+
+  // Returns 0 if the read was started, the error otherwise
+  virtual uint32_t Read(IoFile* file, IoRequest* request, void* buffer, size_t size, uint64_t offset) = 0;
+
+  // Whether a read that failed to start may succeed once others complete
+  virtual bool IsTransientError(uint32_t error) const = 0;
+
+  // The engine for this platform, or nullptr if it can't be used
+  static IoEngine* Default();
+};
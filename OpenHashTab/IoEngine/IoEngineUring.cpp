@@ -0,0 +1,382 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "IoEngine.h"
+
+// liburing is not a dependency, so the few syscalls we need are done by hand
+
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+struct IoFile {
+  int fd{-1};
+  int slot{-1}; // index in the registered file table, or -1
+  IoEngine::Callback callback{};
+  void* ctx{};
+};
+
+namespace {
+  class UringIoEngine final : public IoEngine {
+    static constexpr unsigned k_entries = 256;
+    static constexpr unsigned k_max_fixed_files = 1024;
+    // The kernel won't register a single buffer larger than this, or more
+    // buffers than that
+    static constexpr size_t k_max_buffer_size = 1 << 30;
+    static constexpr size_t k_max_buffers = 1 << 14;
+
+    int _ring_fd{-1};
+
+    void* _sq_ring{MAP_FAILED};
+    size_t _sq_ring_size{};
+    void* _cq_ring{MAP_FAILED};
+    size_t _cq_ring_size{};
+    io_uring_sqe* _sqes{static_cast<io_uring_sqe*>(MAP_FAILED)};
+    size_t _sqes_size{};
+
+    unsigned* _sq_head{};
+    unsigned* _sq_tail{};
+    unsigned _sq_mask{};
+    unsigned _sq_entries{};
+    unsigned* _sq_array{};
+
+    unsigned* _cq_head{};
+    unsigned* _cq_tail{};
+    unsigned _cq_mask{};
+    unsigned _cq_entries{};
+    io_uring_cqe* _cqes{};
+
+    // The submission queue has a single producer
+    std::mutex _submit_mutex;
+
+    // Bounded by the completion queue size, so completions are never dropped
+    std::atomic<unsigned> _in_flight{};
+
+    std::mutex _files_mutex;
+    std::vector<int> _free_slots;
+
+    // Registered memory is a sparse table with a buffer per window, reads
+    // into pinned windows use READ_FIXED
+    uint8_t* _buffers{};
+    size_t _buffers_size{};
+    size_t _window_size{};
+    std::unique_ptr<std::atomic<bool>[]> _pinned;
+
+    std::atomic<bool> _stopping{};
+    std::thread _completion_thread;
+
+    bool UpdateBuffer(size_t window, const iovec& iov) {
+      io_uring_rsrc_update2 update{};
+      update.offset = (uint32_t)window;
+      update.data = (uint64_t)(uintptr_t)&iov;
+      update.nr = 1;
+      return io_uring_register(_ring_fd, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) == 1;
+    }
+
+    bool Submit(uint8_t opcode, int fd, unsigned sqe_flags, const void* addr, size_t len, uint64_t offset, uint16_t buf_index, uint64_t user_data, int& error) {
+      std::lock_guard guard{_submit_mutex};
+
+      const auto tail = *_sq_tail;
+      if (tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) == _sq_entries) {
+        error = EAGAIN;
+        return false;
+      }
+
+      const auto index = tail & _sq_mask;
+      auto& sqe = _sqes[index];
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = opcode;
+      sqe.flags = (uint8_t)sqe_flags;
+      sqe.fd = fd;
+      sqe.addr = (uint64_t)(uintptr_t)addr;
+      sqe.len = (uint32_t)len;
+      sqe.off = offset;
+      sqe.buf_index = buf_index;
+      sqe.user_data = user_data;
+      _sq_array[index] = index;
+      __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+      int ret;
+      do
+        ret = io_uring_enter(_ring_fd, 1, 0, 0);
+      while (ret < 0 && errno == EINTR);
+
+      if (ret >= 0)
+        return true;
+
+      error = errno;
+      // Without SQPOLL the kernel only consumes entries in io_uring_enter, so
+      // if it didn't take ours we can take it back
+      if (__atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) != tail)
+        return true;
+      __atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+      return false;
+    }
+
+    void CompletionThread() {
+      while (true) {
+        const auto head = *_cq_head;
+        if (head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+          io_uring_enter(_ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+          continue;
+        }
+
+        const auto cqe = _cqes[head & _cq_mask];
+        __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+
+        if (cqe.user_data == 0) {
+          if (_stopping)
+            break;
+          continue;
+        }
+
+        --_in_flight;
+
+        const auto request = reinterpret_cast<IoRequest*>((uintptr_t)cqe.user_data);
+        const auto file = reinterpret_cast<IoFile*>((uintptr_t)request->engine_data[0]);
+        // The callback may detach the file, so don't touch it afterwards
+        if (cqe.res < 0)
+          file->callback(file->ctx, request, (uint32_t)-cqe.res, 0);
+        else
+          file->callback(file->ctx, request, 0, (size_t)cqe.res);
+      }
+    }
+
+  public:
+    UringIoEngine() = default;
+
+    ~UringIoEngine() override {
+      if (_completion_thread.joinable()) {
+        _stopping = true;
+        int error;
+        while (!Submit(IORING_OP_NOP, -1, 0, nullptr, 0, 0, 0, 0, error))
+          std::this_thread::yield();
+        _completion_thread.join();
+      }
+
+      if (_sqes != MAP_FAILED)
+        munmap(_sqes, _sqes_size);
+      if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring)
+        munmap(_cq_ring, _cq_ring_size);
+      if (_sq_ring != MAP_FAILED)
+        munmap(_sq_ring, _sq_ring_size);
+      if (_ring_fd >= 0)
+        close(_ring_fd);
+    }
+
+    bool Initialize() {
+      io_uring_params params{};
+      _ring_fd = io_uring_setup(k_entries, &params);
+      if (_ring_fd < 0)
+        return false;
+
+      _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      const auto single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (single_mmap)
+        _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+
+      _sq_ring = mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+      if (_sq_ring == MAP_FAILED)
+        return false;
+
+      _cq_ring = single_mmap
+                   ? _sq_ring
+                   : mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_CQ_RING);
+      if (_cq_ring == MAP_FAILED)
+        return false;
+
+      _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+      _sqes = static_cast<io_uring_sqe*>(
+        mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES)
+      );
+      if (_sqes == MAP_FAILED)
+        return false;
+
+      const auto sq = static_cast<uint8_t*>(_sq_ring);
+      _sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+      _sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+      _sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+      _sq_entries = params.sq_entries;
+      _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+      const auto cq = static_cast<uint8_t*>(_cq_ring);
+      _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+      _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+      _cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+      _cq_entries = params.cq_entries;
+      _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+      // A sparse table of fixed files saves the kernel a file table lookup and
+      // reference count per read. Old kernels can't do this, that's fine
+      std::vector<int> fds(k_max_fixed_files, -1);
+      if (io_uring_register(_ring_fd, IORING_REGISTER_FILES, fds.data(), k_max_fixed_files) == 0)
+        for (auto i = (int)k_max_fixed_files; i-- > 0;)
+          _free_slots.push_back(i);
+
+      _completion_thread = std::thread{[this] { CompletionThread(); }};
+      return true;
+    }
+
+    IoFile* Attach(IoNativeHandle handle, Callback callback, void* ctx) override {
+      const auto file = new IoFile{handle, -1, callback, ctx};
+
+      std::lock_guard guard{_files_mutex};
+      if (!_free_slots.empty()) {
+        const auto slot = _free_slots.back();
+        io_uring_files_update update{};
+        update.offset = (uint32_t)slot;
+        update.fds = (uint64_t)(uintptr_t)&file->fd;
+        if (io_uring_register(_ring_fd, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1) {
+          _free_slots.pop_back();
+          file->slot = slot;
+        }
+      }
+      return file;
+    }
+
+    void Detach(IoFile* file) override {
+      if (file->slot >= 0) {
+        std::lock_guard guard{_files_mutex};
+        const int none = -1;
+        io_uring_files_update update{};
+        update.offset = (uint32_t)file->slot;
+        update.fds = (uint64_t)(uintptr_t)&none;
+        if (io_uring_register(_ring_fd, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1)
+          _free_slots.push_back(file->slot);
+      }
+      delete file;
+    }
+
+    bool RegisterBuffers(void* base, size_t size, size_t window_size) override {
+      UnregisterBuffers();
+
+      const auto windows = (size + window_size - 1) / window_size;
+      if (window_size > k_max_buffer_size || windows > k_max_buffers)
+        return false;
+
+      // Sparse tables need Linux 5.19, older kernels simply don't get fixed
+      // buffers
+      io_uring_rsrc_register reg{};
+      reg.nr = (uint32_t)windows;
+      reg.flags = IORING_RSRC_REGISTER_SPARSE;
+      if (io_uring_register(_ring_fd, IORING_REGISTER_BUFFERS2, &reg, sizeof(reg)) != 0)
+        return false;
+
+      _buffers = static_cast<uint8_t*>(base);
+      _buffers_size = size;
+      _window_size = window_size;
+      _pinned = std::make_unique<std::atomic<bool>[]>(windows);
+      return true;
+    }
+
+    void UnregisterBuffers() override {
+      if (!_buffers)
+        return;
+      io_uring_register(_ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+      _buffers = nullptr;
+      _buffers_size = 0;
+      _window_size = 0;
+      _pinned.reset();
+    }
+
+    bool PinBuffers(size_t window) override {
+      const auto offset = window * _window_size;
+      const iovec iov{_buffers + offset, std::min(_window_size, _buffers_size - offset)};
+      // This faults in and locks the window, and fails if RLIMIT_MEMLOCK is
+      // too low
+      if (!UpdateBuffer(window, iov))
+        return false;
+      _pinned[window] = true;
+      return true;
+    }
+
+    void UnpinBuffers(size_t window) override {
+      _pinned[window] = false;
+      UpdateBuffer(window, iovec{});
+    }
+
+    uint32_t Read(IoFile* file, IoRequest* request, void* buffer, size_t size, uint64_t offset) override {
+      if (++_in_flight > _cq_entries) {
+        --_in_flight;
+        return EAGAIN;
+      }
+
+      request->engine_data[0] = (uint64_t)(uintptr_t)file;
+
+      const auto p = static_cast<uint8_t*>(buffer);
+      auto opcode = (uint8_t)IORING_OP_READ;
+      uint16_t buf_index = 0;
+      if (p >= _buffers && p + size <= _buffers + _buffers_size) {
+        const auto first = (size_t)(p - _buffers) / _window_size;
+        const auto last = (size_t)(p + size - 1 - _buffers) / _window_size;
+        if (first == last && _pinned[first]) {
+          opcode = IORING_OP_READ_FIXED;
+          buf_index = (uint16_t)first;
+        }
+      }
+
+      const auto fd = file->slot >= 0 ? file->slot : file->fd;
+      const auto sqe_flags = file->slot >= 0 ? IOSQE_FIXED_FILE : 0u;
+
+      int error;
+      if (Submit(opcode, fd, sqe_flags, buffer, size, offset, buf_index, (uint64_t)(uintptr_t)request, error))
+        return 0;
+
+      --_in_flight;
+      return (uint32_t)error;
+    }
+
+    bool IsTransientError(uint32_t error) const override {
+      return error == EAGAIN || error == EBUSY || error == ENOMEM;
+    }
+  };
+} // namespace
+
+IoEngine* IoEngine::Default() {
+  static const auto engine = [] {
+    auto engine = std::make_unique<UringIoEngine>();
+    if (!engine->Initialize())
+      engine.reset();
+    return engine;
+  }();
+  return engine.get();
+}
+
+#endif
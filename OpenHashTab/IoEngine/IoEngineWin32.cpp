@@ -0,0 +1,118 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <Windows.h>
+
+#include <memory>
+
+#include "IoEngine.h"
+
+static_assert(sizeof(OVERLAPPED) <= sizeof(IoRequest::engine_data));
+
+struct IoFile {
+  HANDLE handle{};
+  PTP_IO io{};
+  IoEngine::Callback callback{};
+  void* ctx{};
+};
+
+namespace {
+  class Win32IoEngine final : public IoEngine {
+    static VOID WINAPI IoCallback(
+      _Inout_ PTP_CALLBACK_INSTANCE instance,
+      _Inout_opt_ PVOID ctx,
+      _Inout_opt_ PVOID overlapped,
+      _In_ ULONG result,
+      _In_ ULONG_PTR bytes_transferred,
+      _Inout_ PTP_IO io
+    ) {
+      UNREFERENCED_PARAMETER(instance);
+      UNREFERENCED_PARAMETER(io);
+      const auto file = static_cast<IoFile*>(ctx);
+      // The callback may detach the file, so don't touch it afterwards
+      file->callback(
+        file->ctx,
+        CONTAINING_RECORD(overlapped, IoRequest, engine_data),
+        result,
+        bytes_transferred
+      );
+    }
+
+  public:
+    IoFile* Attach(IoNativeHandle handle, Callback callback, void* ctx) override {
+      const auto file = new IoFile{handle, nullptr, callback, ctx};
+      file->io = CreateThreadpoolIo(
+        handle,
+        IoCallback,
+        file,
+        nullptr
+      );
+      if (!file->io) {
+        const auto error = GetLastError();
+        delete file;
+        SetLastError(error);
+        return nullptr;
+      }
+      return file;
+    }
+
+    void Detach(IoFile* file) override {
+      // Callbacks may still be returning, the pool frees the object after them
+      CloseThreadpoolIo(file->io);
+      delete file;
+    }
+
+    uint32_t Read(IoFile* file, IoRequest* request, void* buffer, size_t size, uint64_t offset) override {
+      const auto overlapped = reinterpret_cast<LPOVERLAPPED>(request->engine_data);
+      *overlapped = {};
+      overlapped->Offset = static_cast<DWORD>(offset);
+      overlapped->OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+      StartThreadpoolIo(file->io);
+
+      const auto ret = ReadFile(
+        file->handle,
+        buffer,
+        static_cast<DWORD>(size),
+        nullptr,
+        overlapped
+      );
+
+      const auto error = GetLastError();
+
+      if (ret || error == ERROR_IO_PENDING)
+        return ERROR_SUCCESS;
+
+      CancelThreadpoolIo(file->io);
+      return error;
+    }
+
+    bool IsTransientError(uint32_t error) const override {
+      // We just ran out of memory or outstanding async ios
+      return error == ERROR_INVALID_USER_BUFFER || error == ERROR_NOT_ENOUGH_MEMORY;
+    }
+  };
+} // namespace
+
+IoEngine* IoEngine::Default() {
+  static Win32IoEngine engine;
+  return &engine;
+}
+
+#endif
@@ -0,0 +1,135 @@
+//    Copyright 2019-2025 namazso <admin@namazso.eu>
+//    This file is part of OpenHashTab.
+//
+//    OpenHashTab is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    OpenHashTab is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+
+// Files living on the same volume share a device, so a slow device can't
+// hold up reads from a faster one
+struct ReadDevice {
+  // Large files on devices where each request is expensive are read in bigger
+  // blocks. Rotational disks pay for seeks between files, network shares
+  // pay a round trip per request
+  static constexpr uint64_t k_large_file_size = 64 << 20;      // 64 MB
+  static constexpr size_t k_seek_penalty_block_size = 8 << 20; // 8 MB
+  static constexpr size_t k_remote_block_size = 16 << 20;      // 16 MB
+
+  uint64_t id{};       // anything unique to the volume, like its serial
+  bool remote{};       // on a network share
+  bool seek_penalty{}; // rotational or otherwise slow to seek
+  unsigned reads_in_flight{};
+
+  // Block size to read a file of file_size from here in, where block_size is
+  // the usual one. Files that fit a block are read in one go, into a block of
+  // their exact size
+  size_t BlockSizeFor(uint64_t file_size, size_t block_size) const {
+    if (file_size <= block_size)
+      return std::max<size_t>((size_t)file_size, 1);
+
+    if (file_size >= k_large_file_size) {
+      if (remote)
+        return k_remote_block_size;
+      if (seek_penalty)
+        return k_seek_penalty_block_size;
+    }
+
+    return block_size;
+  }
+};
+
+// Task is whatever waits for reads, the queues only hold pointers to it
+template <typename Task>
+class ReadQueues {
+  struct Device : ReadDevice {
+    std::deque<Task*> waiting;
+  };
+
+  std::mutex _mutex;
+  std::list<Device> _devices;
+  typename std::list<Device>::iterator _next_device{};
+
+public:
+  // Maximum number of reads in flight on a single device. This leaves enough
+  // of the block pool free for other devices to make progress
+  static constexpr unsigned k_max_device_reads = 32;
+
+  // Find or create the device with id. query_class returns something with
+  // remote and seek_penalty, and is only called for new devices
+  template <typename QueryClass>
+  ReadDevice* GetDevice(uint64_t id, QueryClass&& query_class) {
+    {
+      std::lock_guard guard{_mutex};
+      for (auto& device : _devices)
+        if (device.id == id)
+          return &device;
+    }
+
+    // Querying the device may take a while, don't block readers on it
+    const auto volume_class = query_class();
+
+    std::lock_guard guard{_mutex};
+    for (auto& device : _devices)
+      if (device.id == id)
+        return &device;
+    auto& device = _devices.emplace_back();
+    device.id = id;
+    device.remote = volume_class.remote;
+    device.seek_penalty = volume_class.seek_penalty;
+    if (_devices.size() == 1)
+      _next_device = _devices.begin();
+    return &device;
+  }
+
+  bool TryAcquireRead(ReadDevice* device) {
+    std::lock_guard guard{_mutex};
+    if (device->reads_in_flight >= k_max_device_reads)
+      return false;
+    ++device->reads_in_flight;
+    return true;
+  }
+
+  void ReleaseRead(ReadDevice* device) {
+    std::lock_guard guard{_mutex};
+    assert(device->reads_in_flight != 0);
+    --device->reads_in_flight;
+  }
+
+  void Enqueue(ReadDevice* device, Task* task) {
+    std::lock_guard guard{_mutex};
+    static_cast<Device*>(device)->waiting.push_back(task);
+  }
+
+  // Round-robin over devices that have waiting tasks and free read slots
+  Task* Dequeue() {
+    std::lock_guard guard{_mutex};
+    for (size_t i = 0; i < _devices.size(); ++i) {
+      auto& device = *_next_device;
+      if (++_next_device == _devices.end())
+        _next_device = _devices.begin();
+      if (!device.waiting.empty() && device.reads_in_flight < k_max_device_reads) {
+        const auto task = device.waiting.front();
+        device.waiting.pop_front();
+        return task;
+      }
+    }
+    return nullptr;
+  }
+};
@@ -51,6 +51,7 @@ private:
   const HashAlgorithm* _algorithm{};
   const uint64_t* _params{};
   uint32_t _size{};
+  uint32_t _cost{};
   bool _is_secure{};
 
   LegacyHashAlgorithm(
@@ -73,6 +74,8 @@ public:
 
   constexpr uint32_t GetSize() const { return _size; }
 
+  constexpr uint32_t GetCost() const { return _cost; }
+
   constexpr const char* const* GetExtensions() const { return _extensions; }
 
   HashBox MakeContext() const;
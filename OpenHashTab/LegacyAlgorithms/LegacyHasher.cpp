@@ -20,232 +20,32 @@
 #include "Hasher.h"
 
 #include <Windows.h>
-#if defined(_M_IX86) || defined(_M_X64)
-#include <immintrin.h>
-#endif
-
-enum : uint32_t {
-  SSE2_CPUID_MASK = 1u << 26,
-  OSXSAVE_CPUID_MASK = (1u << 26) | (1u << 27),
-  AVX_CPUID_MASK = 1u << 28,
-  AVX2_CPUID_MASK = 1u << 5,
-  AVX512F_CPUID_MASK = 1u << 16,
-  AVX512VL_CPUID_MASK = 1u << 31,
-
-  AVX_XGETBV_MASK = (1u << 2) | (1u << 1),
-  AVX512_XGETBV_MASK = (7u << 5) | (1u << 2) | (1u << 1)
-};
-
-enum CPUFeatureLevel {
-  CPU_None,
-  CPU_X86,
-  CPU_SSE2,
-  CPU_AVX,
-  CPU_AVX2,
-  CPU_AVX512,
-  CPU_NEON,
-
-  CPU_MAX
-};
-
-// Returns the algorithms dll implementation to use
-static CPUFeatureLevel get_cpu_level() {
-  auto best = CPU_None;
-#if defined(_M_IX86)
-  best = CPU_X86;
-#elif defined(_M_X64)
-  int abcdi[4];
-  // Check how many CPUID pages we have
-  __cpuidex(abcdi, 0, 0);
-  const auto max_leaves = abcdi[0];
-
-  // Shouldn't happen on hardware, but happens on some QEMU configs.
-  if (max_leaves == 0)
-    return best;
-
-  // Check for SSE2, OSXSAVE and xgetbv
-  __cpuidex(abcdi, 1, 0);
-
-  uint32_t abcd[4];
-  abcd[0] = (uint32_t)abcdi[0];
-  abcd[1] = (uint32_t)abcdi[1];
-  abcd[2] = (uint32_t)abcdi[2];
-  abcd[3] = (uint32_t)abcdi[3];
-
-  // Test for SSE2. The check is redundant on x86_64, but it doesn't hurt.
-  if ((abcd[3] & SSE2_CPUID_MASK) != SSE2_CPUID_MASK)
-    return best;
-
-  best = CPU_SSE2;
-
-  // Make sure we have enough leaves
-  if (max_leaves < 7)
-    return best;
-
-  // Test for OSXSAVE and XGETBV
-  if ((abcd[2] & OSXSAVE_CPUID_MASK) != OSXSAVE_CPUID_MASK)
-    return best;
-
-  const auto xgetbv_val = _xgetbv(0);
-
-  // Validate that the OS supports YMM registers
-  if ((xgetbv_val & AVX_XGETBV_MASK) != AVX_XGETBV_MASK)
-    return best;
-
-  // Validate that AVX is supported by the CPU
-  if ((abcd[2] & AVX_CPUID_MASK) != AVX_CPUID_MASK)
-    return best;
-
-  // AVX supported
-  best = CPU_AVX;
-
-  // CPUID check for AVX2 features
-  __cpuidex(abcdi, 7, 0);
-  abcd[0] = (uint32_t)abcdi[0];
-  abcd[1] = (uint32_t)abcdi[1];
-  abcd[2] = (uint32_t)abcdi[2];
-  abcd[3] = (uint32_t)abcdi[3];
-
-  // Validate that AVX2 is supported by the CPU
-  if ((abcd[1] & AVX2_CPUID_MASK) != AVX2_CPUID_MASK)
-    return best;
-
-  // AVX2 supported
-  best = CPU_AVX2;
-
-  // Check if AVX512F is supported by the CPU
-  if ((abcd[1] & AVX512F_CPUID_MASK) != AVX512F_CPUID_MASK)
-    return best;
-
-  // Check if AVX512VL is supported by the CPU
-  if ((abcd[1] & AVX512VL_CPUID_MASK) != AVX512VL_CPUID_MASK)
-    return best;
-
-  // Validate that the OS supports ZMM registers
-  if ((xgetbv_val & AVX512_XGETBV_MASK) != AVX512_XGETBV_MASK)
-    return best;
-
-  // AVX512 supported
-  best = CPU_AVX512;
-#elif defined(_M_ARM64)
-  best = CPU_NEON;
-#endif
-  return best;
-}
 
 extern "C" const HashAlgorithm* get_algorithms_begin_x86();
 extern "C" const HashAlgorithm* get_algorithms_end_x86();
 extern "C" const HashAlgorithm* get_algorithms_begin_SSE2();
 extern "C" const HashAlgorithm* get_algorithms_end_SSE2();
-extern "C" const HashAlgorithm* get_algorithms_begin_AVX2();
-extern "C" const HashAlgorithm* get_algorithms_end_AVX2();
-extern "C" const HashAlgorithm* get_algorithms_begin_AVX512();
-extern "C" const HashAlgorithm* get_algorithms_end_AVX512();
 extern "C" const HashAlgorithm* get_algorithms_begin_ARM64();
 extern "C" const HashAlgorithm* get_algorithms_end_ARM64();
 
-#if defined(_M_IX86)
-const HashAlgorithm* get_algorithms_begin(CPUFeatureLevel level) {
-  switch (level) {
-    case CPU_None:
-    case CPU_NEON:
-    case CPU_SSE2:
-    case CPU_AVX2:
-    case CPU_AVX512:
-    case CPU_MAX:
-    default:
-      return nullptr;
-    case CPU_X86:
-      return get_algorithms_begin_x86();
-  }
-}
+struct AlgorithmsDll {
+  const HashAlgorithm* algorithms_begin{};
+  const HashAlgorithm* algorithms_end{};
 
-const HashAlgorithm* get_algorithms_end(CPUFeatureLevel level) {
-  switch (level) {
-    case CPU_None:
-    case CPU_NEON:
-    case CPU_SSE2:
-    case CPU_AVX2:
-    case CPU_AVX512:
-    case CPU_MAX:
-    default:
-      return nullptr;
-    case CPU_X86:
-      return get_algorithms_end_x86();
-  }
-}
+  // One dll per architecture, it picks the kernels for the CPU by itself
+  AlgorithmsDll() {
+#if defined(_M_IX86)
+    algorithms_begin = get_algorithms_begin_x86();
+    algorithms_end = get_algorithms_end_x86();
 #elif defined(_M_X64)
-static const HashAlgorithm* get_algorithms_begin(CPUFeatureLevel level) {
-  switch (level) {
-  case CPU_None:
-  case CPU_X86:
-  case CPU_NEON:
-  case CPU_MAX:
-  default:
-    return nullptr;
-  case CPU_SSE2:
-  case CPU_AVX:
-    return get_algorithms_begin_SSE2();
-  case CPU_AVX2:
-    return get_algorithms_begin_AVX2();
-  case CPU_AVX512:
-    return get_algorithms_begin_AVX512();
-  }
-}
-
-static const HashAlgorithm* get_algorithms_end(CPUFeatureLevel level) {
-  switch (level) {
-  case CPU_None:
-  case CPU_X86:
-  case CPU_NEON:
-  case CPU_MAX:
-  default:
-    return nullptr;
-  case CPU_SSE2:
-  case CPU_AVX:
-    return get_algorithms_end_SSE2();
-  case CPU_AVX2:
-    return get_algorithms_end_AVX2();
-  case CPU_AVX512:
-    return get_algorithms_end_AVX512();
-  }
-}
+    algorithms_begin = get_algorithms_begin_SSE2();
+    algorithms_end = get_algorithms_end_SSE2();
 #elif defined(_M_ARM64)
-const HashAlgorithm* get_algorithms_begin(CPUFeatureLevel level) {
-  switch (level) {
-  case CPU_None:
-  case CPU_X86:
-  case CPU_SSE2:
-  case CPU_AVX2:
-  case CPU_AVX512:
-  case CPU_MAX:
-  default:
-    return nullptr;
-  case CPU_NEON:
-    return get_algorithms_begin_ARM64();
-  }
-}
-
-const HashAlgorithm* get_algorithms_end(CPUFeatureLevel level) {
-  switch (level) {
-  default:
-    return nullptr;
-  case CPU_NEON:
-    return get_algorithms_end_ARM64();
-  }
-}
+    algorithms_begin = get_algorithms_begin_ARM64();
+    algorithms_end = get_algorithms_end_ARM64();
 #else
 #error "Unsupported architecture"
 #endif
-
-struct AlgorithmsDll {
-  const HashAlgorithm* algorithms_begin{};
-  const HashAlgorithm* algorithms_end{};
-
-  AlgorithmsDll() {
-    const auto level = get_cpu_level();
-    algorithms_begin = get_algorithms_begin(level);
-    algorithms_end = get_algorithms_end(level);
   }
 
   ~AlgorithmsDll() = default;
@@ -275,6 +75,7 @@ LegacyHashAlgorithm::LegacyHashAlgorithm(
       assert(_size);
       assert(_size == expected_size);
       _is_secure = it->is_secure;
+      _cost = it->cost;
 
       break;
     }
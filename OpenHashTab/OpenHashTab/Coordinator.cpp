@@ -86,10 +86,8 @@ void Coordinator::ProcessFiles() {
     SendNotifyMessageW(_window, wnd::WM_USER_ALL_FILES_FINISHED, wnd::k_user_magic_wparam, 0);
     return;
   }
-  for (const auto& task : _file_tasks) {
-    ++_files_not_finished;
-    task->StartProcessing();
-  }
+  _files_not_finished += (unsigned)_file_tasks.size();
+  FileHashTask::StartProcessingAll(_file_tasks);
 }
 
 void Coordinator::Cancel(bool wait) {
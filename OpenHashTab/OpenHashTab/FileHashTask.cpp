@@ -16,80 +16,232 @@
 #include "FileHashTask.h"
 
 #include "Coordinator.h"
-#include "Queues.h"
+#include "ReadQueues.h"
 #include "utl.h"
 
-std::atomic<intptr_t> FileHashTask::s_allocations_remaining = k_max_allocations;
+std::once_flag FileHashTask::s_block_pool_once;
+BlockPool* FileHashTask::s_block_pool;
 
-uint8_t* FileHashTask::BlockTryAllocate() {
-  if (--s_allocations_remaining >= 0) {
-    const auto p = VirtualAlloc(
-      nullptr,
-      k_block_size,
-      MEM_RESERVE | MEM_COMMIT,
-      PAGE_READWRITE
-    );
+static ReadQueues<FileHashTask> g_read_queues;
 
-    if (p)
-      return static_cast<uint8_t*>(p);
-  }
+std::mutex FileHashTask::s_batch_mutex;
+std::deque<FileHashTask::Batch> FileHashTask::s_batches;
+unsigned FileHashTask::s_batch_workers{};
+
+std::mutex FileHashTask::s_open_mutex;
+std::deque<FileHashTask*> FileHashTask::s_open_queue;
+unsigned FileHashTask::s_open_files{};
+bool FileHashTask::s_opening{};
+
+FileHashTask::Block FileHashTask::BlockTryAllocate(size_t size) {
+  return s_block_pool->TryAllocate(size);
+}
 
-  ++s_allocations_remaining;
-  return nullptr;
+void FileHashTask::BlockReset(Block block) {
+  s_block_pool->Reset(block);
 }
 
-void FileHashTask::BlockReset(uint8_t* p) {
-  VirtualAlloc(
-    p,
-    k_block_size,
-    MEM_RESET,
-    PAGE_READWRITE
-  );
-  // We don't care about errors
+void FileHashTask::BlockFree(Block block) {
+  s_block_pool->Free(block);
 }
 
-void FileHashTask::BlockFree(uint8_t* p) {
-  const auto ret = VirtualFree(p, 0, MEM_RELEASE);
-  (void)ret;
-  assert(ret);
-  ++s_allocations_remaining;
+size_t FileHashTask::PoolBudget(DWORD configured_mb) {
+  uint64_t budget = (uint64_t)configured_mb << 20;
+
+  if (!budget) {
+    MEMORYSTATUSEX status{sizeof(status)};
+    budget = GlobalMemoryStatusEx(&status) ? status.ullTotalPhys / k_pool_memory_divisor : 1ull << 30;
+  }
+
+  return (size_t)std::clamp(budget, k_min_pool_bytes, k_max_pool_bytes);
 }
 
-VOID NTAPI FileHashTask::HashWorkCallback(
+VOID NTAPI FileHashTask::LaneCallback(
   _Inout_ PTP_CALLBACK_INSTANCE instance,
-  _Inout_opt_ PVOID ctx,
-  _Inout_ PTP_WORK work
+  _Inout_opt_ PVOID ctx
 ) {
   UNREFERENCED_PARAMETER(instance);
-  UNREFERENCED_PARAMETER(work);
-  static_cast<FileHashTask*>(ctx)->DoHashRound();
+  const auto lane = static_cast<HashLane*>(ctx);
+  lane->task->RunLane(*lane);
 }
 
-VOID WINAPI FileHashTask::IoCallback(
+void FileHashTask::IoCallback(void* ctx, IoRequest* request, uint32_t error, size_t bytes_transferred) {
+  static_cast<FileHashTask*>(ctx)->ReadCompletionRoutine(request, error, bytes_transferred);
+}
+
+VOID NTAPI FileHashTask::BatchCallback(
   _Inout_ PTP_CALLBACK_INSTANCE instance,
-  _Inout_opt_ PVOID ctx,
-  _Inout_opt_ PVOID overlapped,
-  _In_ ULONG result,
-  _In_ ULONG_PTR bytes_transferred,
-  _Inout_ PTP_IO io
+  _Inout_opt_ PVOID ctx
 ) {
   UNREFERENCED_PARAMETER(instance);
-  UNREFERENCED_PARAMETER(overlapped);
-  UNREFERENCED_PARAMETER(io);
-  static_cast<FileHashTask*>(ctx)->OverlappedCompletionRoutine(result, bytes_transferred);
+  UNREFERENCED_PARAMETER(ctx);
+
+  const std::unique_ptr<uint8_t[]> slab{new uint8_t[k_batch_size]};
+
+  while (true) {
+    Batch batch;
+    {
+      std::lock_guard guard{s_batch_mutex};
+      if (s_batches.empty()) {
+        --s_batch_workers;
+        break;
+      }
+      batch = std::move(s_batches.front());
+      s_batches.pop_front();
+    }
+    ProcessBatch(batch, slab.get());
+  }
 }
 
-void FileHashTask::ProcessReadQueue(uint8_t* reuse_block) {
-  FileHashTask* waiting_for_read = nullptr;
-  do {
-    auto ret = g_read_queue.try_dequeue(waiting_for_read);
-    if (!ret)
-      break;
-    ret = waiting_for_read->ReadBlockAsync(reuse_block);
-    reuse_block = nullptr;
-    if (!ret)
+void FileHashTask::EnqueueBatch(Batch batch) {
+  {
+    std::lock_guard guard{s_batch_mutex};
+    s_batches.push_back(std::move(batch));
+    if (s_batch_workers >= GetActiveProcessorCount(ALL_PROCESSOR_GROUPS))
+      return;
+    ++s_batch_workers;
+  }
+
+  if (!TrySubmitThreadpoolCallback(BatchCallback, nullptr, nullptr))
+    BatchCallback(nullptr, nullptr);
+}
+
+void FileHashTask::ProcessBatch(Batch& batch, uint8_t* slab) {
+  // Do all reads first, so hashing runs over a buffer that's still in cache.
+  // Each file gets as much of the slab as it had at enumeration
+  size_t offsets[k_batch_files];
+  size_t offset = 0;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const auto capacity = (size_t)batch[i]->_file_size;
+    offsets[i] = offset;
+    offset += capacity;
+    if (!batch[i]->ReadSmallFile(slab + offsets[i], capacity))
+      batch[i] = nullptr;
+  }
+
+  // Go algorithm by algorithm, so the ones with multi-buffer kernels can hash
+  // several files side by side. Variants of the same algorithm, like the
+  // SHA-3 sizes, go together as they can share the kernels too
+  HashBox* boxes[k_batch_files];
+  const void* data[k_batch_files];
+  size_t sizes[k_batch_files];
+  bool grouped[LegacyHashAlgorithm::k_count]{};
+  for (auto algorithm = 0u; algorithm < LegacyHashAlgorithm::k_count; ++algorithm) {
+    if (grouped[algorithm])
+      continue;
+    const HashBox* first = nullptr;
+    size_t count = 0;
+    for (auto variant = algorithm; variant < LegacyHashAlgorithm::k_count; ++variant) {
+      if (grouped[variant])
+        continue;
+      for (size_t i = 0; i < batch.size(); ++i) {
+        const auto task = batch[i];
+        if (!task || task->_error != ERROR_SUCCESS || !task->_hash_contexts[variant].IsInitialized())
+          continue;
+        if (!task->AbsorbsItself(variant))
+          continue;
+        auto& box = task->_hash_contexts[variant];
+        if (!first)
+          first = &box;
+        else if (!box.SameAlgorithm(*first))
+          break;
+        grouped[variant] = true;
+        if (count == k_batch_files) {
+          HashBox::UpdateMany(boxes, data, sizes, count);
+          count = 0;
+        }
+        boxes[count] = &box;
+        data[count] = slab + offsets[i];
+        sizes[count] = (size_t)task->_file_size;
+        ++count;
+      }
+    }
+    HashBox::UpdateMany(boxes, data, sizes, count);
+  }
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const auto task = batch[i];
+    if (!task)
+      continue;
+
+    const auto size = (size_t)task->_file_size;
+
+    if (size)
+      task->_prop_page->FileProgressCallback(size);
+
+    // The task may be deleted after this
+    task->Finish();
+  }
+}
+
+bool FileHashTask::ReadSmallFile(uint8_t* buffer, size_t capacity) {
+  if (_cancelled) {
+    _error = ERROR_CANCELLED;
+    return true;
+  }
+
+  if (Open(capacity)) {
+    // Grew since enumeration, this is rare enough to not count it in the open window
+    StartReading();
+    return false;
+  }
+
+  if (_error != ERROR_SUCCESS || _file_size == 0)
+    return true;
+
+  // The handle is opened for overlapped I/O, so we wait for the read here
+  OVERLAPPED overlapped{};
+  if (!ReadFile(_handle, buffer, static_cast<DWORD>(_file_size), nullptr, &overlapped)) {
+    const auto error = GetLastError();
+    if (error != ERROR_IO_PENDING) {
+      _error = error;
+      return true;
+    }
+  }
+
+  DWORD read{};
+  if (!GetOverlappedResult(_handle, &overlapped, &read, TRUE))
+    _error = GetLastError();
+  else if (read != _file_size)
+    _error = ERROR_HANDLE_EOF;
+  return true;
+}
+
+void FileHashTask::OpenQueuedFiles(bool closed) {
+  {
+    std::lock_guard guard{s_open_mutex};
+    if (closed)
+      --s_open_files;
+    // Whoever is opening files already will notice the room we made
+    if (s_opening)
+      return;
+    s_opening = true;
+  }
+
+  while (true) {
+    FileHashTask* task;
+    {
+      std::lock_guard guard{s_open_mutex};
+      if (s_open_files >= k_max_open_files || s_open_queue.empty()) {
+        s_opening = false;
+        return;
+      }
+      task = s_open_queue.front();
+      s_open_queue.pop_front();
+      ++s_open_files;
+    }
+    task->_in_open_window = true;
+    task->StartProcessing();
+  }
+}
+
+void FileHashTask::ProcessReadQueue(Block reuse_block) {
+  while (const auto waiting_for_read = g_read_queues.Dequeue()) {
+    const auto wait = waiting_for_read->ReadBlocksAsync(std::exchange(reuse_block, {}));
+    // A file that lost the race for a device slot doesn't stop other devices
+    if (wait == ReadWait::Block)
       break;
-  } while (true);
+  }
   if (reuse_block)
     BlockFree(reuse_block);
 }
@@ -97,190 +249,646 @@ void FileHashTask::ProcessReadQueue(uint8_t* reuse_block) {
 FileHashTask::FileHashTask(Coordinator* prop_page, const std::wstring& path, ProcessedFileList::FileInfo file_info)
     : _hash_contexts{}
     , _prop_page{prop_page}
+    , _path{path}
     , _file_info{std::move(file_info)} {
+  // Nothing is opened or allocated until the task gets its turn, until then
+  // the size is what enumeration saw
+  for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i) {
+    _lparam_idx[i] = static_cast<uint8_t>(i);
+    _absorbed_by[i] = static_cast<uint8_t>(i);
+  }
+
+  _file_size = _file_info.size;
+
+  _read_ahead = std::clamp<unsigned>(_prop_page->settings.read_ahead_depth, 1, k_max_read_ahead);
+}
+
+bool FileHashTask::Open(uint64_t batch_capacity) {
   // Instead of exception, set _error because a failed file is still a finished
   // file task. Finish mechanism will trigger on first block read
 
-  for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i) {
-    _lparam_idx[i] = static_cast<uint8_t>(i);
+  for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i)
     if (_prop_page->settings.algorithms[i])
       _hash_contexts[i] = LegacyHashAlgorithm::Algorithms()[i].MakeContext();
-  }
 
-  _handle = utl::OpenForRead(path, true);
+  ShareAbsorption();
+  BuildLanes();
+
+  _handle = utl::OpenForRead(_path, true);
 
   if (_handle == INVALID_HANDLE_VALUE) {
     _error = GetLastError();
-    return;
+    return false;
   }
 
   BY_HANDLE_FILE_INFORMATION fi;
   if (!GetFileInformationByHandle(_handle, &fi)) {
     _error = GetLastError();
-    return;
+    return false;
   }
 
   _file_size = static_cast<uint64_t>(fi.nFileSizeHigh) << 32 | fi.nFileSizeLow;
-  _file_index = static_cast<uint64_t>(fi.nFileIndexHigh) << 32 | fi.nFileIndexLow;
-
-  // TODO: use this in queue so a lot of files from a slower device can't slow down another faster device
   _volume_serial = fi.dwVolumeSerialNumber;
+  _creation_time = fi.ftCreationTime;
 
-  _threadpool_hash_work = CreateThreadpoolWork(
-    HashWorkCallback,
-    this,
-    nullptr
-  );
+  // Files read in batches aren't attached to the I/O engine
+  if (_file_size <= batch_capacity)
+    return false;
 
-  if (!_threadpool_hash_work) {
-    _error = GetLastError();
-    return;
+  _device = g_read_queues.GetDevice(_volume_serial, [&] { return utl::GetVolumeClass(_path); });
+  _block_size = _device->BlockSizeFor(_file_size, k_block_size);
+
+  // Blocks hold whole pieces of algorithms that want them bigger than usual,
+  // otherwise no piece would ever fit in one
+  for (auto i = 0u; i < _lane_count; ++i) {
+    const auto piece_size = _lanes[i].piece_size;
+    if (piece_size > k_piece_size && piece_size <= BlockPool::k_max_block_size && _file_size > piece_size)
+      _block_size = std::max<size_t>(_block_size / piece_size, 1) * piece_size;
   }
 
-  _threadpool_io = CreateThreadpoolIo(
-    _handle,
-    IoCallback,
-    this,
-    nullptr
-  );
+  _io_file = IoEngine::Default()->Attach(_handle, IoCallback, this);
 
-  if (!_threadpool_io) {
+  if (!_io_file) {
     _error = GetLastError();
-    return;
+    return false;
   }
+
+  return true;
 }
 
 FileHashTask::~FileHashTask() {
-  assert(_block == nullptr);
+  for (const auto& slot : _slots)
+    assert(!slot.block);
 
   if (_handle != INVALID_HANDLE_VALUE)
     CloseHandle(_handle);
-  if (_threadpool_hash_work)
-    CloseThreadpoolWork(_threadpool_hash_work);
-  if (_threadpool_io)
-    CloseThreadpoolIo(_threadpool_io);
+  if (_io_file)
+    IoEngine::Default()->Detach(_io_file);
+}
+
+void FileHashTask::ShareAbsorption() {
+  for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i) {
+    if (!_hash_contexts[i].IsInitialized())
+      continue;
+    for (auto j = 0u; j < i; ++j) {
+      if (AbsorbsItself(j) && _hash_contexts[j].IsInitialized() && _hash_contexts[i].SharesAbsorption(_hash_contexts[j])) {
+        _absorbed_by[i] = static_cast<uint8_t>(j);
+        break;
+      }
+    }
+  }
+}
+
+void FileHashTask::BuildLanes() {
+  const auto& algorithms = LegacyHashAlgorithm::Algorithms();
+
+  // Algorithms that hash pieces spread over workers on their own, so they
+  // get a lane each instead of being packed with the others
+  unsigned enabled[LegacyHashAlgorithm::k_count];
+  unsigned enabled_count = 0;
+  auto active_count = 0u;
+  for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i) {
+    const auto& ctx = _hash_contexts[i];
+    if (!ctx.IsInitialized() || !AbsorbsItself(i))
+      continue;
+    if (!ctx.HasPieces()) {
+      enabled[enabled_count++] = i;
+      continue;
+    }
+    auto& lane = _lanes[_lane_count++];
+    lane.task = this;
+    lane.contexts = &_active_contexts[active_count];
+    lane.context_count = 1;
+    lane.pieces.resize(_read_ahead);
+    lane.piece_size = std::max(k_piece_size, ctx.PieceSize());
+    _active_contexts[active_count++] = &_hash_contexts[i];
+  }
+  const auto piece_lane_count = _lane_count;
+
+  std::stable_sort(std::begin(enabled), std::begin(enabled) + enabled_count, [&](unsigned a, unsigned b) {
+    return algorithms[a].GetCost() > algorithms[b].GetCost();
+  });
+
+  auto capacity = k_min_lane_cost;
+  for (auto i = 0u; i < enabled_count; ++i)
+    capacity = std::max(capacity, algorithms[enabled[i]].GetCost());
+
+  // First fit decreasing
+  uint32_t lane_cost[LegacyHashAlgorithm::k_count]{};
+  unsigned lane_of[LegacyHashAlgorithm::k_count]{};
+  for (auto i = 0u; i < enabled_count; ++i) {
+    const auto cost = algorithms[enabled[i]].GetCost();
+    auto lane = piece_lane_count;
+    while (lane < _lane_count && lane_cost[lane] + cost > capacity)
+      ++lane;
+    if (lane == _lane_count)
+      ++_lane_count;
+    lane_cost[lane] += cost;
+    lane_of[i] = lane;
+  }
+
+  for (auto lane = piece_lane_count; lane < _lane_count; ++lane) {
+    auto& it = _lanes[lane];
+    it.task = this;
+    it.contexts = &_active_contexts[active_count];
+    for (auto i = 0u; i < enabled_count; ++i)
+      if (lane_of[i] == lane)
+        _active_contexts[active_count++] = &_hash_contexts[enabled[i]];
+    it.context_count = (unsigned)(&_active_contexts[active_count] - it.contexts);
+  }
+}
+
+void FileHashTask::StartProcessingAll(const std::list<std::unique_ptr<FileHashTask>>& tasks) {
+  if (tasks.empty())
+    return;
+
+  const auto& settings = tasks.front()->_prop_page->settings;
+  const auto budget = PoolBudget(settings.memory_budget_mb);
+  std::call_once(s_block_pool_once, [&] {
+    // The pool lives as long as the process and runs our code on its own
+    // threads, so we can't be unloaded from then on
+    HMODULE module;
+    GetModuleHandleExW(
+      GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+      reinterpret_cast<LPCWSTR>(utl::GetInstance()),
+      &module
+    );
+    s_block_pool = new BlockPool(budget, settings.large_pages, settings.reset_freed_blocks, IoEngine::Default());
+    s_block_pool->WatchMemoryPressure();
+  });
+  // Every property sheet loads the settings anew, the pool picks them up once idle
+  s_block_pool->Configure(budget, settings.large_pages, settings.reset_freed_blocks);
+
+  Batch batch;
+  size_t batch_size = 0;
+  std::vector<FileHashTask*> to_open;
+  for (const auto& task : tasks) {
+    task->_prop_page->Reference();
+
+    if (!task->IsSmall()) {
+      to_open.push_back(task.get());
+      continue;
+    }
+
+    if (batch.size() == k_batch_files || batch_size + task->_file_size > k_batch_size) {
+      EnqueueBatch(std::exchange(batch, {}));
+      batch_size = 0;
+    }
+
+    batch.push_back(task.get());
+    batch_size += (size_t)task->_file_size;
+  }
+
+  if (!batch.empty())
+    EnqueueBatch(std::move(batch));
+
+  {
+    std::lock_guard guard{s_open_mutex};
+    s_open_queue.insert(s_open_queue.end(), to_open.begin(), to_open.end());
+  }
+
+  OpenQueuedFiles(false);
 }
 
 void FileHashTask::StartProcessing() {
-  _prop_page->Reference();
-  ReadBlockAsync();
+  // Cancelled files don't need to be opened, the pipeline will just finish them
+  if (!_cancelled)
+    Open();
+  StartReading();
 }
 
-bool FileHashTask::ReadBlockAsync(uint8_t* reuse_block) {
-  if (_error != ERROR_SUCCESS) {
-    if (reuse_block)
-      BlockFree(reuse_block);
-    Finish();
-    return true;
+void FileHashTask::StartReading() {
+  // The device may have freed up before we got in line
+  if (ReadBlocksAsync() == ReadWait::Device)
+    ProcessReadQueue();
+}
+
+FileHashTask::ReadWait FileHashTask::ReadBlocksAsync(Block reuse_block) {
+  ReadWait wait;
+  ReadDevice* device;
+  bool finish;
+  {
+    std::lock_guard guard{_mutex};
+    wait = IssueReadsLocked(reuse_block);
+    finish = TryFinishLocked(reuse_block);
+    device = _device;
   }
 
-  // Set up OVERLAPPED fields for either reading or enqueueing for read
-  _overlapped.Internal = 0;     // reserved
-  _overlapped.InternalHigh = 0; // reserved
-  _overlapped.Offset = static_cast<DWORD>(_current_offset);
-  _overlapped.OffsetHigh = static_cast<DWORD>(_current_offset >> 32);
-  //_overlapped.hEvent = this; // for caller use
+  // Past this point "this" may be already deleted, unless we finish it
 
-  if (const auto block = reuse_block ? reuse_block : BlockTryAllocate()) {
-    const auto read_size = static_cast<DWORD>(GetCurrentBlockSize());
+  if (reuse_block)
+    BlockFree(reuse_block);
 
-    StartThreadpoolIo(_threadpool_io);
+  if (finish)
+    Finish();
+  else if (wait != ReadWait::None)
+    g_read_queues.Enqueue(device, this);
 
-    _block = block;
+  return wait;
+}
 
-    const auto ret = ReadFile(
-      _handle,
-      block,
-      read_size,
-      nullptr,
-      &_overlapped
-    );
+FileHashTask::ReadWait FileHashTask::IssueReadsLocked(Block& reuse_block) {
+  auto device_full = false;
+  while (_error == ERROR_SUCCESS && !_cancelled && _read_block - _head_block < _read_ahead && _read_offset < _file_size) {
+    if (!g_read_queues.TryAcquireRead(_device)) {
+      device_full = true;
+      break;
+    }
 
-    const auto error = GetLastError();
+    // A block from another file is only good if it's not much bigger than we need
+    if (reuse_block && (reuse_block.size < _block_size || reuse_block.size > std::bit_ceil(std::max(_block_size, k_block_size))))
+      BlockFree(std::exchange(reuse_block, {}));
 
-    if (ret || error == ERROR_IO_PENDING) // succeeded
-      return true;
+    const auto block = reuse_block ? std::exchange(reuse_block, {}) : BlockTryAllocate(_block_size);
+    if (!block) {
+      g_read_queues.ReleaseRead(_device);
+      break;
+    }
 
-    _block = nullptr;
+    auto& slot = _slots[_read_block % _read_ahead];
+    slot.block = block;
+    slot.offset = _read_offset;
+    slot.size = (size_t)std::min<uint64_t>(_file_size - _read_offset, _block_size);
+    slot.refs = _lane_count;
+    slot.ready = false;
 
-    CancelThreadpoolIo(_threadpool_io);
+    const auto engine = IoEngine::Default();
+
+    const auto error = engine->Read(_io_file, &slot.request, block.data, slot.size, slot.offset);
+
+    if (error == ERROR_SUCCESS) {
+      ++_read_block;
+      ++_reads_in_flight;
+      _read_offset += slot.size;
+      continue;
+    }
+
+    slot.block = {};
+
+    g_read_queues.ReleaseRead(_device);
 
     // We failed to start the async operation, free block - cant give it back
     BlockFree(block);
 
+    // If we just ran out of memory or outstanding async ios, try again later
+    if (engine->IsTransientError(error))
+      break;
+
     // If we got some unknown error don't reschedule, fail instead
-    if (error != ERROR_INVALID_USER_BUFFER && error != ERROR_NOT_ENOUGH_MEMORY) {
-      assert(_error);
-      _error = error;
-      Finish();
+    _error = error;
+  }
+
+  // We only need to wait in queue if nothing else will wake us up
+  if (_error == ERROR_SUCCESS && !_cancelled && _read_block == _head_block && _read_offset < _file_size)
+    return device_full ? ReadWait::Device : ReadWait::Block;
+  return ReadWait::None;
+}
+
+void FileHashTask::ReleaseBlocksLocked(Block& reuse_block) {
+  uint64_t progress = 0;
+  while (_head_block != _read_block) {
+    auto& slot = _slots[_head_block % _read_ahead];
+    if (!slot.ready || slot.refs != 0)
+      break;
+    ++_head_block;
+    progress += slot.size;
+    const auto block = std::exchange(slot.block, {});
+    if (reuse_block)
+      BlockFree(block);
+    else
+      reuse_block = block;
+  }
+  if (progress) {
+    _current_offset += progress;
+    _prop_page->FileProgressCallback(progress);
+  }
+}
+
+FileHashTask::BlockSlot* FileHashTask::NextSlotForLaneLocked(const HashLane& lane) {
+  if (_error != ERROR_SUCCESS || _cancelled || lane.next_block == _read_block)
+    return nullptr;
+  auto& slot = _slots[lane.next_block % _read_ahead];
+  return slot.ready ? &slot : nullptr;
+}
+
+size_t FileHashTask::StartLanesLocked(HashLane** to_start) {
+  size_t count = 0;
+  for (auto i = 0u; i < _lane_count; ++i) {
+    auto& lane = _lanes[i];
+    // Piece lanes need a single worker to get going, it starts more as it finds work for them
+    if (!lane.pieces.empty()) {
+      if (!lane.workers && HasPieceWorkLocked(lane)) {
+        lane.workers = 1;
+        ++_lanes_running;
+        to_start[count++] = &lane;
+      }
+      continue;
+    }
+    if (!lane.running && NextSlotForLaneLocked(lane)) {
+      lane.running = true;
+      ++_lanes_running;
+      to_start[count++] = &lane;
+    }
+  }
+  return count;
+}
+
+bool FileHashTask::HasPieceWorkLocked(const HashLane& lane) {
+  if (_error != ERROR_SUCCESS || _cancelled)
+    return false;
+  if (!lane.absorbing && lane.absorb_block != lane.next_block) {
+    const auto& block = lane.pieces[lane.absorb_block % _read_ahead];
+    if (block.hashed == block.count)
       return true;
+  }
+  return NextSlotForLaneLocked(lane) != nullptr;
+}
+
+void FileHashTask::SplitBlockLocked(HashLane& lane, const BlockSlot& slot, PieceBlock& block) {
+  const auto box = lane.contexts[0];
+
+  block.runs.clear();
+  block.count = 0;
+  block.stride = 0;
+  block.split = true;
+
+  // The end of the file has to go through Update
+  if (slot.offset + slot.size >= _file_size)
+    return;
+
+  for (size_t offset = 0; offset < slot.size;) {
+    const auto to_cut = (size_t)(lane.piece_size - (slot.offset + offset) % lane.piece_size);
+    const auto size = std::min(to_cut, slot.size - offset);
+    const auto summary_size = box->PieceSummarySize(slot.offset + offset, size);
+    // Neighboring runs that can't be pieces go through Update together
+    if (!summary_size && !block.runs.empty() && !block.runs.back().summary_size)
+      block.runs.back().size += size;
+    else
+      block.runs.push_back({offset, size, summary_size});
+    if (summary_size) {
+      ++block.count;
+      block.stride = std::max(block.stride, summary_size);
     }
+    offset += size;
   }
 
-  // If we just ran out of memory or outstanding async ios, requeue
-  g_read_queue.enqueue(this);
+  if (!block.count)
+    block.runs.clear();
+  block.summaries.resize(block.stride * block.runs.size());
+}
+
+bool FileHashTask::ClaimPieceWorkLocked(HashLane& lane, PieceWork& work) {
+  while (_error == ERROR_SUCCESS && !_cancelled) {
+    // Absorbing goes first, it's what lets blocks be released
+    if (!lane.absorbing && lane.absorb_block != lane.next_block) {
+      auto& block = lane.pieces[lane.absorb_block % _read_ahead];
+      if (block.hashed == block.count) {
+        lane.absorbing = true;
+        work = {&_slots[lane.absorb_block % _read_ahead], &block, PieceWork::k_absorb};
+        return true;
+      }
+    }
+
+    const auto slot = NextSlotForLaneLocked(lane);
+    if (!slot)
+      return false;
+
+    auto& block = lane.pieces[lane.next_block % _read_ahead];
+    if (!block.split) {
+      SplitBlockLocked(lane, *slot, block);
+      // Blocks that go through Update are only absorbed
+      if (!block.count) {
+        ++lane.next_block;
+        continue;
+      }
+    }
+
+    while (!block.runs[block.next_run].summary_size)
+      ++block.next_run;
+    work = {slot, &block, block.next_run++};
+    if (++block.claimed == block.count)
+      ++lane.next_block;
+    return true;
+  }
   return false;
 }
 
-void FileHashTask::OverlappedCompletionRoutine(ULONG error_code, ULONG_PTR bytes_transferred) {
-  UNREFERENCED_PARAMETER(bytes_transferred);
+void FileHashTask::CompletePieceWorkLocked(HashLane& lane, const PieceWork& work, Block& reuse_block) {
+  if (work.piece != PieceWork::k_absorb) {
+    ++work.block->hashed;
+    return;
+  }
+
+  work.block->count = 0;
+  work.block->claimed = 0;
+  work.block->hashed = 0;
+  work.block->next_run = 0;
+  work.block->split = false;
+  lane.absorbing = false;
+  ++lane.absorb_block;
+  --work.slot->refs;
+  ReleaseBlocksLocked(reuse_block);
+}
+
+void FileHashTask::SubmitLanes(HashLane* const* lanes, size_t count) {
+  // Running lanes keep the task alive, so this is fine to call after unlocking
+  for (size_t i = 0; i < count; ++i)
+    if (!TrySubmitThreadpoolCallback(LaneCallback, lanes[i], nullptr))
+      lanes[i]->task->RunLane(*lanes[i]);
+}
+
+bool FileHashTask::TryFinishLocked(Block& reuse_block) {
+  if (_finished || _lanes_running != 0 || _reads_in_flight != 0)
+    return false;
+
+  if (_error == ERROR_SUCCESS && _current_offset < _file_size) {
+    if (!_cancelled)
+      return false;
+    _error = ERROR_CANCELLED;
+  }
+
+  // Nothing is in flight anymore, so any blocks still held are read but unhashed
+  for (; _head_block != _read_block; ++_head_block) {
+    const auto block = std::exchange(_slots[_head_block % _read_ahead].block, {});
+    if (reuse_block)
+      BlockFree(block);
+    else
+      reuse_block = block;
+  }
+
+  _finished = true;
+  return true;
+}
+
+void FileHashTask::ReadCompletionRoutine(IoRequest* request, DWORD error_code, size_t bytes_transferred) {
+  const auto slot = CONTAINING_RECORD(request, BlockSlot, request);
 
-  uint8_t* reuse_block = nullptr;
+  // The file shrank under us, the rest of the block holds stale bytes
+  if (error_code == ERROR_SUCCESS && bytes_transferred != slot->size)
+    error_code = ERROR_HANDLE_EOF;
 
-  if (_cancelled)
-    error_code = ERROR_CANCELLED;
+  Block reuse_block{};
+  HashLane* to_start[LegacyHashAlgorithm::k_count];
+  size_t start_count;
+  ReadWait wait;
+  ReadDevice* device;
+  bool finish;
+  {
+    std::lock_guard guard{_mutex};
 
-  if (error_code != ERROR_SUCCESS) {
-    _error = error_code;
-    reuse_block = _block;
-    _block = nullptr;
+    --_reads_in_flight;
+    g_read_queues.ReleaseRead(_device);
+    slot->ready = true;
+
+    if (_cancelled)
+      error_code = ERROR_CANCELLED;
+
+    if (error_code != ERROR_SUCCESS && _error == ERROR_SUCCESS)
+      _error = error_code;
+
+    // Only does anything if there are no lanes at all
+    ReleaseBlocksLocked(reuse_block);
+    wait = IssueReadsLocked(reuse_block);
+    start_count = StartLanesLocked(to_start);
+    finish = TryFinishLocked(reuse_block);
+    device = _device;
+  }
+
+  if (reuse_block)
     BlockReset(reuse_block);
+
+  SubmitLanes(to_start, start_count);
+
+  if (finish)
     Finish();
-  } else {
-    AddToHashQueue();
-  }
+  else if (wait != ReadWait::None)
+    g_read_queues.Enqueue(device, this);
 
   ProcessReadQueue(reuse_block);
 }
 
-void FileHashTask::AddToHashQueue() {
-  assert(_block);
+void FileHashTask::RunLane(HashLane& lane) {
+  if (!lane.pieces.empty()) {
+    RunPieceLane(lane);
+    return;
+  }
 
-  _hash_start_counter.store(LegacyHashAlgorithm::k_count, std::memory_order_relaxed);
-  _hash_finish_counter.store(LegacyHashAlgorithm::k_count, std::memory_order_relaxed);
+  Block reuse_block{};
+  auto wait = ReadWait::None;
+  ReadDevice* device = nullptr;
+  bool finish = false;
+  BlockSlot* slot = nullptr;
+
+  while (true) {
+    {
+      std::lock_guard guard{_mutex};
+
+      if (slot) {
+        ++lane.next_block;
+        --slot->refs;
+        ReleaseBlocksLocked(reuse_block);
+        wait = IssueReadsLocked(reuse_block);
+        device = _device;
+      }
 
-  for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i)
-    SubmitThreadpoolWork(_threadpool_hash_work);
-}
-
-void FileHashTask::DoHashRound() {
-  const auto ctx_index = --_hash_start_counter;
-  auto& ctx = _hash_contexts[ctx_index];
-  const auto block_size = GetCurrentBlockSize();
-  if (ctx.IsInitialized())
-    ctx.Update(_block, block_size);
-  const auto locks_on_this = --_hash_finish_counter;
-  if (locks_on_this == 0)
-    FinishedBlock();
-}
-
-void FileHashTask::FinishedBlock() {
-  const auto block_size = GetCurrentBlockSize();
-  _prop_page->FileProgressCallback(block_size);
-  _current_offset += block_size;
-  auto reuse_block = _block;
-  _block = nullptr;
-  BlockReset(reuse_block);
-
-  if (GetCurrentBlockSize() > 0 && !_cancelled) {
-    ReadBlockAsync(reuse_block);
-    reuse_block = nullptr;
-  } else {
-    if (_cancelled)
-      _error = ERROR_CANCELLED;
+      slot = NextSlotForLaneLocked(lane);
+
+      if (!slot) {
+        // We'll get restarted when our next block is read
+        lane.running = false;
+        --_lanes_running;
+        finish = TryFinishLocked(reuse_block);
+        break;
+      }
+    }
+
+    HashBox::UpdateFused(lane.contexts, lane.context_count, slot->block.data, slot->size);
+  }
+
+  // Past this point "this" may be already deleted, unless we finish it
+
+  if (reuse_block)
+    BlockReset(reuse_block);
+
+  if (finish)
     Finish();
+  else if (wait != ReadWait::None)
+    g_read_queues.Enqueue(device, this);
+
+  ProcessReadQueue(reuse_block);
+}
+
+void FileHashTask::RunPieceLane(HashLane& lane) {
+  const auto box = lane.contexts[0];
+
+  Block reuse_block{};
+  auto wait = ReadWait::None;
+  ReadDevice* device = nullptr;
+  bool finish = false;
+  PieceWork work{};
+
+  while (true) {
+    bool start_worker = false;
+    {
+      std::lock_guard guard{_mutex};
+
+      if (work.slot) {
+        CompletePieceWorkLocked(lane, work, reuse_block);
+        if (work.piece == PieceWork::k_absorb) {
+          wait = IssueReadsLocked(reuse_block);
+          device = _device;
+        }
+      }
+
+      if (!ClaimPieceWorkLocked(lane, work)) {
+        // We'll get restarted when a block is read
+        --lane.workers;
+        --_lanes_running;
+        finish = TryFinishLocked(reuse_block);
+        break;
+      }
+
+      // Bring in another worker if there's more to do than the ones running can take
+      if (lane.workers < GetActiveProcessorCount(ALL_PROCESSOR_GROUPS) && HasPieceWorkLocked(lane)) {
+        ++lane.workers;
+        ++_lanes_running;
+        start_worker = true;
+      }
+    }
+
+    if (start_worker) {
+      HashLane* const to_start[] = {&lane};
+      SubmitLanes(to_start, 1);
+    }
+
+    const auto slot = work.slot;
+    const auto block = work.block;
+    if (work.piece != PieceWork::k_absorb) {
+      const auto& run = block->runs[work.piece];
+      box->HashPiece(slot->offset + run.offset, slot->block.data + run.offset, run.size, block->summaries.data() + work.piece * block->stride);
+    } else if (!block->count) {
+      box->Update(slot->block.data, slot->size);
+    } else {
+      for (auto i = 0u; i < block->runs.size(); ++i) {
+        const auto& run = block->runs[i];
+        if (run.summary_size)
+          box->AbsorbPiece(slot->offset + run.offset, run.size, block->summaries.data() + i * block->stride);
+        else
+          box->Update(slot->block.data + run.offset, run.size);
+      }
+    }
   }
 
+  // Past this point "this" may be already deleted, unless we finish it
+
+  if (reuse_block)
+    BlockReset(reuse_block);
+
+  if (finish)
+    Finish();
+  else if (wait != ReadWait::None)
+    g_read_queues.Enqueue(device, this);
+
   ProcessReadQueue(reuse_block);
 }
 
@@ -289,6 +897,11 @@ void FileHashTask::Finish() {
     // If we expect a hash but none match, write no match to all algos
     _match_state = _file_info.expected_hashes.empty() ? MatchState_None : MatchState_Mismatch;
 
+    // Before anything finishes, as that may change the state that's taken over
+    for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i)
+      if (_hash_contexts[i].IsInitialized() && !AbsorbsItself(i))
+        _hash_contexts[i].AbsorbFrom(_hash_contexts[_absorbed_by[i]]);
+
     for (auto i = 0u; i < LegacyHashAlgorithm::k_count; ++i) {
       auto& it_result = _hash_results[i];
       auto& it_ctx = _hash_contexts[i];
@@ -307,6 +920,17 @@ void FileHashTask::Finish() {
     }
   }
 
+  // Handles are only kept while the file is being processed
+  if (_handle != INVALID_HANDLE_VALUE)
+    CloseHandle(std::exchange(_handle, INVALID_HANDLE_VALUE));
+  if (_io_file)
+    IoEngine::Default()->Detach(std::exchange(_io_file, nullptr));
+
+  const auto in_open_window = _in_open_window;
+
   _prop_page->FileCompletionCallback(this);
   _prop_page->Dereference();
+
+  if (in_open_window)
+    OpenQueuedFiles(true);
 }
@@ -15,75 +15,227 @@
 //    along with OpenHashTab.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
+#include "BlockPool.h"
+#include "IoEngine.h"
 #include "path.h"
 
 class Coordinator;
+struct ReadDevice;
 
 class FileHashTask {
   // Increasing this will make CPU use more efficient,
-  // but also increase memory usage
+  // but also increase memory usage. Files up to this size are read whole.
+  // ReadDevice picks bigger blocks for large files on slow devices
   static constexpr size_t k_block_size = 2 << 20; // 2 MB
 
-  // Increasing this will increase memory use and reduce
-  // possibility of a slower disk clogging up the queue
-  static constexpr intptr_t k_max_allocations = 512; // 1 GB
+  // Files up to this size skip the block pipeline. They are read with a single
+  // request each into a shared slab, and hashed in batches by one work item
+  static constexpr uint64_t k_small_file_size = 64 << 10; // 64 KB
 
-  static std::atomic<intptr_t> s_allocations_remaining;
+  // Limits for a single batch of small files
+  static constexpr size_t k_batch_size = 1 << 20; // 1 MB
+  static constexpr size_t k_batch_files = 256;
 
-  static uint8_t* BlockTryAllocate();
-  static void BlockReset(uint8_t* p);
-  static void BlockFree(uint8_t* p);
+  // Other files are opened lazily, with at most this many open at once. Files
+  // that are open but can't read yet act as look-ahead, so reads don't have
+  // to wait for an open
+  static constexpr unsigned k_max_open_files = 64;
 
-  static VOID NTAPI HashWorkCallback(
+  // Increasing the block pool size will increase memory use and reduce
+  // possibility of a slower disk clogging up the queue. Unless configured, it
+  // is this fraction of physical memory, within the limits below
+  static constexpr uint64_t k_pool_memory_divisor = 32;
+  static constexpr uint64_t k_min_pool_bytes = 128 << 20; // 128 MB
+  // 16 GB, or 512 MB on 32 bit where address space is tight
+  static constexpr uint64_t k_max_pool_bytes = sizeof(void*) == 8 ? 16ull << 30 : 512 << 20;
+
+  // Maximum number of blocks a single file may have read or being read ahead
+  // of the one currently being hashed. The actual depth is a setting.
+  static constexpr unsigned k_max_read_ahead = 8;
+
+  // Blocks are cut into pieces of this size for algorithms that can hash them
+  // apart from their context, so a single file keeps several processors busy.
+  // Algorithms that want bigger pieces get those, and cuts are made at
+  // multiples of the piece size in the file
+  static constexpr size_t k_piece_size = 512 << 10; // 512 KB
+
+  // Algorithms are packed into lanes so that no lane costs more than the most
+  // expensive enabled algorithm, or this much if that one is cheaper.
+  // See HashAlgorithm::cost for units
+  static constexpr uint32_t k_min_lane_cost = 4000;
+
+  using Block = BlockPool::Block;
+
+  // Shared by all tasks, created with the settings of the first job
+  static std::once_flag s_block_pool_once;
+  static BlockPool* s_block_pool;
+
+  static Block BlockTryAllocate(size_t size);
+  static void BlockReset(Block block);
+  static void BlockFree(Block block);
+
+  static size_t PoolBudget(DWORD configured_mb);
+
+  // Pick the block size for a file based on its size and the device it's on
+
+  static VOID NTAPI LaneCallback(
     _Inout_ PTP_CALLBACK_INSTANCE instance,
-    _Inout_opt_ PVOID ctx,
-    _Inout_ PTP_WORK work
+    _Inout_opt_ PVOID ctx
   );
 
-  static VOID WINAPI IoCallback(
+  static void IoCallback(void* ctx, IoRequest* request, uint32_t error, size_t bytes_transferred);
+
+  using Batch = std::vector<FileHashTask*>;
+
+  // Batches waiting for a worker, there is at most one worker per processor
+  static std::mutex s_batch_mutex;
+  static std::deque<Batch> s_batches;
+  static unsigned s_batch_workers;
+
+  static VOID NTAPI BatchCallback(
     _Inout_ PTP_CALLBACK_INSTANCE instance,
-    _Inout_opt_ PVOID ctx,
-    _Inout_opt_ PVOID overlapped,
-    _In_ ULONG result,
-    _In_ ULONG_PTR bytes_transferred,
-    _Inout_ PTP_IO io
+    _Inout_opt_ PVOID ctx
   );
 
-  static void ProcessReadQueue(uint8_t* reuse_block = nullptr);
+  static void EnqueueBatch(Batch batch);
 
-  uint8_t* _block{nullptr};
+  static void ProcessBatch(Batch& batch, uint8_t* slab);
 
-  PTP_WORK _threadpool_hash_work = nullptr;
+  // Files waiting for room in the open window
+  static std::mutex s_open_mutex;
+  static std::deque<FileHashTask*> s_open_queue;
+  static unsigned s_open_files;
+  static bool s_opening;
+
+  // Start queued files while the open window has room. Set closed if the
+  // caller just finished a file from the window
+  static void OpenQueuedFiles(bool closed);
+
+  // Why a file with nothing in flight couldn't start a read
+  enum class ReadWait {
+    None,
+    Block,  // the block pool is exhausted
+    Device, // the device already has as many reads in flight as allowed
+  };
 
-  PTP_IO _threadpool_io = nullptr;
+  // Start reads for waiting files, round-robin over their devices
+  static void ProcessReadQueue(Block reuse_block = {});
+
+  struct BlockSlot {
+    IoRequest request{};
+    Block block{};
+    uint64_t offset{};
+    size_t size{};
+    unsigned refs{}; // lanes that still have to hash this block
+    bool ready{};
+  };
+
+  // A part of a block, hashed as a piece or fed to Update when absorbed
+  struct PieceRun {
+    size_t offset{}; // in the block
+    size_t size{};
+    size_t summary_size{}; // 0 if the run goes through Update
+  };
+
+  // Where a piece lane is with a block of the ring
+  struct PieceBlock {
+    std::vector<PieceRun> runs; // empty if the whole block goes through Update
+    std::vector<uint8_t> summaries;
+    size_t stride{};    // summary bytes per run
+    unsigned count{};   // runs that are pieces
+    unsigned claimed{};
+    unsigned hashed{};
+    unsigned next_run{}; // where to look for the next piece to claim
+    bool split{};
+  };
+
+  // A hash lane consumes the blocks of the ring in order, at its own pace,
+  // feeding each to one or more algorithms. With more than one, the block is
+  // walked in cache sized tiles so it's only pulled from memory once.
+  //
+  // Algorithms that can hash pieces get a lane of their own. Its blocks are
+  // cut into pieces hashed by as many workers as there are pieces ready, then
+  // absorbed in order by one worker at a time
+  struct HashLane {
+    FileHashTask* task{};
+    HashBox** contexts{};
+    unsigned context_count{};
+    uint64_t next_block{};
+    bool running{};
+
+    // Only used by piece lanes, which have one entry per ring slot
+    std::vector<PieceBlock> pieces;
+    size_t piece_size{};
+    unsigned workers{};
+    uint64_t absorb_block{};
+    bool absorbing{};
+  };
+
+  // A piece to hash, or a whole block to absorb
+  struct PieceWork {
+    static constexpr unsigned k_absorb = ~0u;
+
+    BlockSlot* slot{};
+    PieceBlock* block{};
+    unsigned piece{};
+  };
+
+  IoFile* _io_file{};
 
   HashBox _hash_contexts[LegacyHashAlgorithm::k_count];
 
-  OVERLAPPED _overlapped{};
+  // Which context absorbs the file for each one. Variants of the same
+  // primitive are only fed to the first of them, and the others take over its
+  // state when finishing
+  uint8_t _absorbed_by[LegacyHashAlgorithm::k_count]{};
+
+  // Enabled contexts, grouped by lane
+  HashBox* _active_contexts[LegacyHashAlgorithm::k_count]{};
+
+  // Protects the ring and lane state and offsets below
+  std::mutex _mutex;
+
+  // Ring of blocks, block n lives in _slots[n % _read_ahead]. Blocks in
+  // [_head_block, _read_block) are either being read or waiting for lanes.
+  BlockSlot _slots[k_max_read_ahead]{};
+  unsigned _read_ahead{1};
+  uint64_t _head_block{};
+  uint64_t _read_block{};
+  unsigned _reads_in_flight{};
+
+  HashLane _lanes[LegacyHashAlgorithm::k_count]{};
+  unsigned _lane_count{};
+  unsigned _lanes_running{};
+
+  bool _finished{};
 
   using hash_results_t = std::array<std::vector<uint8_t>, LegacyHashAlgorithm::k_count>;
 
   hash_results_t _hash_results;
 
-  HANDLE _handle;
+  HANDLE _handle{INVALID_HANDLE_VALUE};
 
   Coordinator* _prop_page;
 
+  std::wstring _path;
+
   ProcessedFileList::FileInfo _file_info;
 
   uint64_t _file_size{};
+  size_t _block_size{k_block_size};
+  uint64_t _read_offset{};
   uint64_t _current_offset{};
 
-  uint64_t _file_index;
-  uint32_t _volume_serial;
+  uint32_t _volume_serial{};
+  FILETIME _creation_time{};
 
-  DWORD _error{ERROR_SUCCESS};
+  ReadDevice* _device{};
 
-  std::atomic<unsigned> _hash_start_counter{0};
-  std::atomic<unsigned> _hash_finish_counter{0};
+  DWORD _error{ERROR_SUCCESS};
 
   int _match_state{};
   bool _cancelled{};
+  bool _in_open_window{};
 
   uint8_t _lparam_idx[LegacyHashAlgorithm::k_count]{};
 
@@ -95,36 +247,86 @@ public:
 
   FileHashTask(Coordinator* prop_page, const std::wstring& path, ProcessedFileList::FileInfo file_info);
 
-  // You should only ever delete this object after Finish() was called or StartProcessing() was never called.
+  // You should only ever delete this object after Finish() was called or StartProcessingAll() was never called.
   // TODO: check this somehow
   ~FileHashTask();
 
-  void StartProcessing();
+  // Start processing all tasks, with small files grouped into batches
+  static void StartProcessingAll(const std::list<std::unique_ptr<FileHashTask>>& tasks);
 
 private:
-  // Enqueue the next block for reading
-  // Returns true if an async io was started, false if the file was enqueued
-  bool ReadBlockAsync(uint8_t* reuse_block = nullptr);
+  // Open the file and set up the hash contexts. Unless the file fits in
+  // batch_capacity, also set up the block pipeline and return true
+  bool Open(uint64_t batch_capacity = 0);
+
+  void StartProcessing();
+
+  // Start the block pipeline on an opened file
+  void StartReading();
+
+  // Fill up free slots in the ring with reads.
+  // Returns why the file was enqueued for waiting, if it was
+  ReadWait ReadBlocksAsync(Block reuse_block = {});
+
+  // The following expect _mutex to be held
+
+  // Start reads into the free slots of the ring, using reuse_block first if
+  // it's the right size for this file.
+  // Returns whether the file has nothing in flight and must wait in queue.
+  ReadWait IssueReadsLocked(Block& reuse_block);
+
+  // Release fully hashed blocks from the head of the ring, and hand one for reuse
+  void ReleaseBlocksLocked(Block& reuse_block);
 
-  void OverlappedCompletionRoutine(ULONG error_code, ULONG_PTR bytes_transferred);
+  // Returns the slot the lane should hash next, if it's ready
+  BlockSlot* NextSlotForLaneLocked(const HashLane& lane);
 
-  void AddToHashQueue();
+  // Mark idle lanes that have a block to hash as running, returns their count
+  size_t StartLanesLocked(HashLane** to_start);
 
-  void DoHashRound();
+  // Whether a piece lane has a piece to hash or a block to absorb
+  bool HasPieceWorkLocked(const HashLane& lane);
 
-  void FinishedBlock();
+  // Cut the lane's next block into pieces, and runs between them that have to
+  // go through Update
+  void SplitBlockLocked(HashLane& lane, const BlockSlot& slot, PieceBlock& block);
+
+  // Returns false if the lane has nothing to do right now
+  bool ClaimPieceWorkLocked(HashLane& lane, PieceWork& work);
+
+  void CompletePieceWorkLocked(HashLane& lane, const PieceWork& work, Block& reuse_block);
+
+  // Returns true if the caller should call Finish(), in which case one of the
+  // blocks previously held is returned in reuse_block
+  bool TryFinishLocked(Block& reuse_block);
+
+  void ReadCompletionRoutine(IoRequest* request, DWORD error_code, size_t bytes_transferred);
+
+  bool IsSmall() const { return _file_size <= k_small_file_size; }
+
+  // Open and read the whole file into buffer synchronously. Returns false if
+  // the file no longer fits and was handed over to the block pipeline
+  bool ReadSmallFile(uint8_t* buffer, size_t capacity);
+
+  // Point variants of the same primitive at the first one of them
+  void ShareAbsorption();
+
+  bool AbsorbsItself(unsigned algorithm) const { return _absorbed_by[algorithm] == algorithm; }
+
+  // Pack the enabled algorithms into lanes by cost
+  void BuildLanes();
+
+  // Submit lanes that were marked running by StartLanesLocked
+  static void SubmitLanes(HashLane* const* lanes, size_t count);
+
+  void RunLane(HashLane& lane);
+
+  void RunPieceLane(HashLane& lane);
 
   // Do NOT use "this" after calling Finish(), as it might be deleted
   // This may be the last reference to Coordinator, which then deletes us in destructor.
   void Finish();
 
-  size_t GetCurrentBlockSize() const {
-    auto size = _file_size - _current_offset;
-    if (size > k_block_size)
-      size = k_block_size;
-    return (size_t)size;
-  }
-
 public:
   LPARAM ToLparam(size_t hasher) const { return reinterpret_cast<LPARAM>(&_lparam_idx[hasher]); }
 
@@ -137,7 +339,7 @@ public:
 
   uint64_t GetSize() const { return _file_size; }
 
-  HANDLE GetHandle() const { return _handle; }
+  FILETIME GetCreationTime() const { return _creation_time; }
 
   const hash_results_t& GetHashResult() const { return _hash_results; }
 
@@ -93,6 +93,18 @@ struct Settings {
   RegistrySetting<bool> hash_sumfile_too{"HashSumfileToo", false};
   RegistrySetting<bool> sumfile_algorithm_only{"SumfileAlgorithmOnly", true};
 
+  // Number of blocks read ahead per file while hashing. Not exposed on the UI.
+  RegistrySetting<DWORD> read_ahead_depth{"ReadAheadDepth", 4};
+
+  // Megabytes of memory used for read blocks, 0 picks a fraction of physical memory. Not exposed on the UI.
+  RegistrySetting<DWORD> memory_budget_mb{"MemoryBudgetMB", 0};
+
+  // Back read blocks with large pages, if the user may lock pages in memory. Not exposed on the UI.
+  RegistrySetting<bool> large_pages{"LargePages", false};
+
+  // Let the OS discard the contents of read blocks once they're hashed. Not exposed on the UI.
+  RegistrySetting<bool> reset_freed_blocks{"ResetFreedBlocks", false};
+
   // Following are the color settings. Defaults:
   //
   // No hash to compare to  - system colors
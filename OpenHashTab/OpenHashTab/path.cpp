@@ -56,12 +56,23 @@ static std::wstring NormalizePath(std::wstring_view path) {
   }
 }
 
+// Returns 0 on failure, opening the file later will report the error
+static uint64_t QueryFileSize(const std::wstring& path) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+    return 0;
+  return static_cast<uint64_t>(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+}
+
 ProcessedFileList ProcessEverything(std::list<std::wstring> list, const Settings* settings) {
   ProcessedFileList pfl;
 
   pfl.sumfile_type = -2;
   std::list<std::pair<std::wstring, std::vector<uint8_t>>> fsl_absolute;
 
+  // Sizes of files found while listing directories, keyed by the path pushed to list
+  std::unordered_map<std::wstring, uint64_t> listed_sizes;
+
   if (list.size() == 1) {
     auto& file = *list.begin();
 
@@ -153,6 +164,7 @@ ProcessedFileList ProcessEverything(std::list<std::wstring> list, const Settings
       ProcessedFileList::FileInfo fi;
       fi.relative_path = std::move(relative_path);
       fi.expected_hashes.emplace_back(entry.second);
+      fi.size = QueryFileSize(normalized);
       pfl.files[normalized] = fi;
     }
   }
@@ -160,7 +172,9 @@ ProcessedFileList ProcessEverything(std::list<std::wstring> list, const Settings
   for (const auto& file : list) {
     const auto normalized = NormalizePath(file);
 
-    if (PathIsDirectoryW(normalized.c_str())) {
+    const auto listed = listed_sizes.find(file);
+
+    if (listed == listed_sizes.end() && PathIsDirectoryW(normalized.c_str())) {
       DWORD error = 0;
 
       {
@@ -176,7 +190,10 @@ ProcessedFileList ProcessEverything(std::list<std::wstring> list, const Settings
             if (find_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
               continue;
 
-            list.push_back(normalized + L"\\" + find_data.cFileName);
+            auto path = normalized + L"\\" + find_data.cFileName;
+            if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+              listed_sizes[path] = static_cast<uint64_t>(find_data.nFileSizeHigh) << 32 | find_data.nFileSizeLow;
+            list.push_back(std::move(path));
           } while (FindNextFileW(find_handle, &find_data) != 0);
           error = GetLastError();
           FindClose(find_handle);
@@ -219,6 +236,8 @@ not_a_directory:
       else
         fi.relative_path = normalized;
 
+      fi.size = listed != listed_sizes.end() ? listed->second : QueryFileSize(normalized);
+
       const auto exist = pfl.files.find(normalized);
       if (exist == pfl.files.end())
         pfl.files[normalized] = fi;
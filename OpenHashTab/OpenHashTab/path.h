@@ -35,6 +35,9 @@ struct ProcessedFileList {
 
     // Expected hashes. We'll try to figure out which belongs to what algorithm
     std::list<std::vector<uint8_t>> expected_hashes;
+
+    // Size when the file was found, so we don't have to open it for progress
+    uint64_t size{};
   };
 
   // Files to hash, keyed by normalized path
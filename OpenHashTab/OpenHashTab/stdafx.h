@@ -72,8 +72,10 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
 #include <cassert>
 #include <cstdint>
+#include <deque>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -209,6 +209,61 @@ HANDLE utl::OpenForRead(const std::wstring& file, bool async) {
   );
 }
 
+utl::VolumeClass utl::GetVolumeClass(const std::wstring& file) {
+  VolumeClass result;
+
+  wchar_t volume_path[MAX_PATH];
+  if (!GetVolumePathNameW(MakePathLongCompatible(file).c_str(), volume_path, (DWORD)std::size(volume_path)))
+    return result;
+
+  if (GetDriveTypeW(volume_path) == DRIVE_REMOTE) {
+    result.remote = true;
+    return result;
+  }
+
+  wchar_t volume_name[MAX_PATH];
+  if (!GetVolumeNameForVolumeMountPointW(volume_path, volume_name, (DWORD)std::size(volume_name)))
+    return result;
+
+  // The volume device must be opened without the trailing backslash
+  const auto len = wcslen(volume_name);
+  if (len && volume_name[len - 1] == L'\\')
+    volume_name[len - 1] = 0;
+
+  const auto volume = CreateFileW(
+    volume_name,
+    0,
+    FILE_SHARE_READ | FILE_SHARE_WRITE,
+    nullptr,
+    OPEN_EXISTING,
+    0,
+    nullptr
+  );
+  if (volume == INVALID_HANDLE_VALUE)
+    return result;
+
+  STORAGE_PROPERTY_QUERY query{};
+  query.PropertyId = StorageDeviceSeekPenaltyProperty;
+  query.QueryType = PropertyStandardQuery;
+  DEVICE_SEEK_PENALTY_DESCRIPTOR seek_penalty{};
+  DWORD returned{};
+  if (DeviceIoControl(
+        volume,
+        IOCTL_STORAGE_QUERY_PROPERTY,
+        &query,
+        sizeof(query),
+        &seek_penalty,
+        sizeof(seek_penalty),
+        &returned,
+        nullptr
+      )
+      && returned >= sizeof(seek_penalty))
+    result.seek_penalty = seek_penalty.IncursSeekPenalty;
+
+  CloseHandle(volume);
+  return result;
+}
+
 DWORD utl::SetClipboardText(HWND hwnd, std::wstring_view text) {
   DWORD error;
 
@@ -143,6 +143,14 @@ namespace utl {
 
   HANDLE OpenForRead(const std::wstring& file, bool async = false);
 
+  struct VolumeClass {
+    bool remote{};
+    bool seek_penalty{};
+  };
+
+  // Find out what kind of storage a file is on. Unknown means local and fast
+  VolumeClass GetVolumeClass(const std::wstring& file);
+
   DWORD SetClipboardText(HWND hwnd, std::wstring_view text);
 
   std::wstring GetClipboardText(HWND hwnd);
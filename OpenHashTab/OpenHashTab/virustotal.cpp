@@ -59,8 +59,7 @@ std::list<vt::Result> vt::Query(const std::list<FileHashTask*>& files, size_t al
       char hash[LegacyHashAlgorithm::k_max_size * 2 + 1]{};
       utl::HashBytesToString(hash, h->GetHashResult()[algo]);
 
-      FILETIME ft{};
-      GetFileTime(h->GetHandle(), &ft, nullptr, nullptr);
+      const auto ft = h->GetCreationTime();
       SYSTEMTIME st{};
       FileTimeToSystemTime(&ft, &st);
 
@@ -220,7 +220,7 @@ New-Item -Path "install" -ItemType Directory -Force
 New-Item -Path "install\algorithms" -ItemType Directory -Force
 $AlgorithmsInstallDir = (Get-Item "install\algorithms").FullName;
 
-"x86", "SSE2", "AVX2", "AVX512", "ARM64" | ForEach-Object {
+"x86", "SSE2", "ARM64" | ForEach-Object {
     If ($_ -eq "x86") {
         $Environment = $x86_Environment;
     } Elseif ($_ -eq "ARM64") {